@@ -0,0 +1,1271 @@
+// Benchmarks for the inverse kinematics solvers.
+// Usage: IK_BENCH [name ...]
+// With no names every benchmark is run.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "include/ikbatch.h"
+#include "include/ikchain.h"
+#include "include/ikchain3d.h"
+#include "include/ikfixed.h"
+#include "include/ikhierarchy.h"
+#include "include/iklinalg.h"
+#include "include/ikrandom.h"
+#include "include/ikreach.h"
+#include "include/iksimd.h"
+#include "include/iksolver.h"
+#include "include/iktask.h"
+#include "include/iktrack.h"
+#include "include/iktree.h"
+#include "include/ikwarmstart.h"
+
+using namespace std;
+
+const double PI = 4 * atan(1.0);
+
+// Wall clock time in seconds
+double now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Link lengths of the arm in main.cpp
+const double demoLengths[] = { 25, 20, 15, 10 };
+
+// Link lengths for an n-link arm that tapers like the demo arm
+vector<double> taperedLengths(int n)
+{
+    vector<double> lengths(n);
+    for (int i = 0; i < n; ++i)
+        lengths[i] = 70.0 * (n - i) / (n * (n + 1) / 2.0);
+    return lengths;
+}
+
+// The four-link update that idle() used to perform, written out by hand
+struct FourLinkReference
+{
+    double l[4];
+    double a[4];
+
+    void step(double tX, double tY, double stepSize, double & dist)
+    {
+        double s1 = a[0], s2 = s1 + a[1], s3 = s2 + a[2], s4 = s3 + a[3];
+        double x = l[0] * cos(s1) + l[1] * cos(s2) + l[2] * cos(s3) + l[3] * cos(s4);
+        double y = l[0] * sin(s1) + l[1] * sin(s2) + l[2] * sin(s3) + l[3] * sin(s4);
+        double deltaX = tX - x;
+        double deltaY = tY - y;
+        dist = sqrt(deltaX * deltaX + deltaY * deltaY);
+        double rd = stepSize / dist;
+        deltaX *= rd;
+        deltaY *= rd;
+
+        double j[2][4];
+        j[0][3] = - l[3] * sin(s4);
+        j[0][2] = - l[2] * sin(s3) + j[0][3];
+        j[0][1] = - l[1] * sin(s2) + j[0][2];
+        j[0][0] = - l[0] * sin(s1) + j[0][1];
+        j[1][3] = l[3] * cos(s4);
+        j[1][2] = l[2] * cos(s3) + j[1][3];
+        j[1][1] = l[1] * cos(s2) + j[1][2];
+        j[1][0] = l[0] * cos(s1) + j[1][1];
+
+        double jjt[2][2];
+        for (int r = 0; r < 2; ++r)
+            for (int c = 0; c < 2; ++c)
+            {
+                jjt[r][c] = 0;
+                for (int k = 0; k < 4; ++k)
+                    jjt[r][c] += j[r][k] * j[c][k];
+            }
+        double det = jjt[0][0] * jjt[1][1] - jjt[0][1] * jjt[1][0];
+        if (det == 0)
+            return;
+        double jjti[2][2];
+        jjti[0][0] =   jjt[1][1] / det;
+        jjti[0][1] = - jjt[0][1] / det;
+        jjti[1][0] = - jjt[1][0] / det;
+        jjti[1][1] =   jjt[0][0] / det;
+        for (int r = 0; r < 4; ++r)
+            a[r] += (j[0][r] * jjti[0][0] + j[1][r] * jjti[1][0]) * deltaX
+                  + (j[0][r] * jjti[0][1] + j[1][r] * jjti[1][1]) * deltaY;
+    }
+};
+
+// Check IKChain against the hand-written four-link update, then time
+// forward() + solveStep() for a range of chain lengths.
+void benchChain()
+{
+    FourLinkReference ref = { { 25, 20, 15, 10 }, { -PI/4, -PI/4, -PI/4, -PI/4 } };
+    IKChain chain(demoLengths, 4, -PI/4);
+    IKRandom rng;
+    double tX, tY;
+    rng.target(chain.reach(), tX, tY);
+    double maxDiff = 0;
+    for (int it = 0; it < 200000; ++it)
+    {
+        double dist;
+        ref.step(tX, tY, 0.01, dist);
+        chain.forward();
+        double dx = tX - chain.tipX(), dy = tY - chain.tipY();
+        double d = sqrt(dx * dx + dy * dy);
+        chain.solveStep(dx * 0.01 / d, dy * 0.01 / d);
+        for (int i = 0; i < 4; ++i)
+            maxDiff = max(maxDiff, fabs(ref.a[i] - chain.angle(i)));
+        if (dist < 0.1)
+            rng.target(chain.reach(), tX, tY);
+    }
+    printf("chain: max |angle difference| from 4-link reference after 200000 steps: %.3g\n", maxDiff);
+
+    printf("%8s %14s\n", "links", "ns/iteration");
+    const int sizes[] = { 2, 4, 6, 8, 12, 16, 24, 32, 40, 64, 128 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        int n = sizes[s];
+        IKChain arm(taperedLengths(n), -PI/4);
+        IKRandom targets;
+        targets.target(arm.reach(), tX, tY);
+        const int iterations = 2000000 / n + 10000;
+        double start = now();
+        for (int it = 0; it < iterations; ++it)
+        {
+            arm.forward();
+            double dx = tX - arm.tipX(), dy = tY - arm.tipY();
+            double d = sqrt(dx * dx + dy * dy);
+            if (d < 0.1)
+            {
+                targets.target(arm.reach(), tX, tY);
+                continue;
+            }
+            arm.solveStep(dx * 0.01 / d, dy * 0.01 / d);
+        }
+        double elapsed = now() - start;
+        printf("%8d %14.1f\n", n, 1e9 * elapsed / iterations);
+    }
+}
+
+// Throughput of solveBatch() against a loop that steps one IKChain per arm
+void benchBatch()
+{
+    const int arms = 4096;
+    const int steps = 200;
+    const int sizes[] = { 4, 16, 40 };
+    printf("batch: %d arms, %d steps, %s kernels\n", arms, steps, simdName());
+    printf("%8s %18s %18s %8s %12s\n", "links", "scalar arm-steps/s", "batch arm-steps/s", "speedup", "max diff");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        int n = sizes[s];
+        vector<double> lengths = taperedLengths(n);
+        vector<double> tX(arms), tY(arms);
+        IKRandom rng;
+        for (int a = 0; a < arms; ++a)
+            rng.target(70, tX[a], tY[a]);
+
+        vector<IKChain> chains(arms, IKChain(lengths, -PI/4));
+        double start = now();
+        for (int a = 0; a < arms; ++a)
+        {
+            IKChain & chain = chains[a];
+            for (int it = 0; it < steps; ++it)
+            {
+                chain.forward();
+                double dx = tX[a] - chain.tipX(), dy = tY[a] - chain.tipY();
+                double d = sqrt(dx * dx + dy * dy);
+                if (d < 0.1)
+                    break;
+                chain.solveStep(dx * 0.01 / d, dy * 0.01 / d);
+            }
+        }
+        double scalar = now() - start;
+
+        ChainBatch batch(&lengths[0], n, arms, -PI/4);
+        start = now();
+        solveBatch(batch, &tX[0], &tY[0], steps);
+        double batched = now() - start;
+
+        double maxDiff = 0;
+        for (int a = 0; a < arms; ++a)
+            for (int j = 0; j < n; ++j)
+                maxDiff = max(maxDiff, fabs(batch.angle(a, j) - chains[a].angle(j)));
+        double work = double(arms) * steps;
+        printf("%8d %18.3g %18.3g %8.2f %12.3g\n", n, work / scalar, work / batched, scalar / batched, maxDiff);
+    }
+}
+
+// Steps taken to reach each target of a chooseTarget() sequence with the
+// idle() update rule, for each solveStep() method
+void benchDamping()
+{
+    const int targets = 300;
+    const int cap = 20000;
+    const char *names[] = { "pseudo-inverse", "damped LS", "SVD" };
+    const IKMethod methods[] = { PSEUDO_INVERSE, DAMPED_LEAST_SQUARES, SVD };
+    const int sizes[] = { 4, 12 };
+
+    // Check the SVD route against the closed-form 2 x n pseudo-inverse
+    {
+        IKChain a(taperedLengths(7), 0.3), b(taperedLengths(7), 0.3);
+        b.setMethod(SVD);
+        b.setDamping(0, 0);
+        a.forward();
+        b.forward();
+        a.solveStep(0.02, -0.01);
+        b.solveStep(0.02, -0.01);
+        double diff = 0;
+        for (int i = 0; i < 7; ++i)
+            diff = max(diff, fabs(a.angle(i) - b.angle(i)));
+        printf("damping: undamped SVD vs closed-form pseudo-inverse, max difference %.3g\n", diff);
+    }
+
+    // Each target is approached either from wherever the previous one left
+    // the arm, as in main.cpp, or from the straight (singular) pose.
+    printf("damping: %d targets, cap %d steps per target\n", targets, cap);
+    printf("%6s %-9s %-15s %12s %10s %8s %10s %12s\n",
+           "links", "start", "method", "mean steps", "max steps", "capped", "singular", "us/target");
+    for (int straight = 0; straight < 2; ++straight)
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            for (int m = 0; m < 3; ++m)
+            {
+                int n = sizes[s];
+                IKChain arm(n == 4 ? vector<double>(demoLengths, demoLengths + 4) : taperedLengths(n), -PI/4);
+                arm.setMethod(methods[m]);
+                IKRandom rng;
+                long total = 0;
+                int worst = 0, capped = 0, singular = 0;
+                double start = now();
+                for (int t = 0; t < targets; ++t)
+                {
+                    double tX, tY;
+                    rng.target(arm.reach(), tX, tY);
+                    if (straight)
+                        for (int i = 0; i < n; ++i)
+                            arm.setAngle(i, 0);
+                    int it = 0;
+                    for (; it < cap; ++it)
+                    {
+                        arm.forward();
+                        double dx = tX - arm.tipX(), dy = tY - arm.tipY();
+                        double d = sqrt(dx * dx + dy * dy);
+                        if (d < 0.1)
+                            break;
+                        if (!arm.solveStep(dx * 0.01 / d, dy * 0.01 / d))
+                            ++singular;
+                    }
+                    total += it;
+                    worst = max(worst, it);
+                    if (it == cap)
+                        ++capped;
+                }
+                double elapsed = now() - start;
+                printf("%6d %-9s %-15s %12.1f %10d %8d %10d %12.1f\n", n, straight ? "straight" : "previous",
+                       names[m], double(total) / targets, worst, capped, singular, 1e6 * elapsed / targets);
+            }
+}
+
+// Iterations, time and final error per target for each IK engine on the
+// same chooseTarget() sequence
+void benchSolvers()
+{
+    const int targets = 300;
+    const int cap = 20000;
+    const double tolerances[] = { 0.1, 0.001 };
+    const int sizes[] = { 4, 12, 40 };
+    printf("solvers: %d targets, cap %d iterations per target\n", targets, cap);
+    printf("%6s %9s %-12s %12s %10s %8s %12s %12s\n",
+           "links", "tolerance", "solver", "mean iters", "max iters", "capped", "us/target", "mean error");
+    for (size_t t = 0; t < sizeof(tolerances) / sizeof(tolerances[0]); ++t)
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            for (int e = 0; solverNames[e]; ++e)
+            {
+                int n = sizes[s];
+                IKChain arm(n == 4 ? vector<double>(demoLengths, demoLengths + 4) : taperedLengths(n), -PI/4);
+                IKSolver *solver = newSolver(solverNames[e]);
+                IKRandom rng;
+                long total = 0;
+                int worst = 0, capped = 0;
+                double error = 0;
+                double start = now();
+                for (int k = 0; k < targets; ++k)
+                {
+                    double tX, tY;
+                    rng.target(arm.reach(), tX, tY);
+                    int it = solver->solve(arm, tX, tY, tolerances[t], cap);
+                    total += it;
+                    worst = max(worst, it);
+                    if (it == cap)
+                        ++capped;
+                    error += hypot(tX - arm.tipX(), tY - arm.tipY());
+                }
+                double elapsed = now() - start;
+                printf("%6d %9g %-12s %12.1f %10d %8d %12.2f %12.3g\n", n, tolerances[t], solver->name(),
+                       double(total) / targets, worst, capped, 1e6 * elapsed / targets, error / targets);
+                delete solver;
+            }
+}
+
+// Targets reached per second of wall time by each JacobianSolver step control
+void benchStepping()
+{
+    const double budget = 0.5;
+    const StepControl controls[] = { FIXED_STEP, LINE_SEARCH, TRUST_REGION };
+    const int sizes[] = { 4, 12, 40 };
+    printf("stepping: %.1f s per run, tolerance 0.1, cap 20000 iterations per target\n", budget);
+    printf("%6s %-12s %14s %12s %10s\n", "links", "control", "targets/s", "mean iters", "gain");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        double fixedRate = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int n = sizes[s];
+            IKChain arm(n == 4 ? vector<double>(demoLengths, demoLengths + 4) : taperedLengths(n), -PI/4);
+            JacobianSolver solver(0.01, controls[c]);
+            IKRandom rng;
+            long iterations = 0;
+            int reached = 0;
+            double start = now(), elapsed = 0;
+            while (elapsed < budget)
+            {
+                double tX, tY;
+                rng.target(arm.reach(), tX, tY);
+                int it = solver.solve(arm, tX, tY, 0.1, 20000);
+                iterations += it;
+                if (it < 20000)
+                    ++reached;
+                elapsed = now() - start;
+            }
+            double rate = reached / elapsed;
+            if (c == 0)
+                fixedRate = rate;
+            printf("%6d %-12s %14.1f %12.1f %10.1f\n", n, solver.name(), rate,
+                   double(iterations) / max(reached, 1), rate / fixedRate);
+        }
+    }
+}
+
+// ns per forward() + solveStep() for any chain type with IKChain's interface
+template <class Chain>
+double timeSteps(Chain & arm, int iterations)
+{
+    IKRandom targets;
+    double tX, tY;
+    targets.target(arm.reach(), tX, tY);
+    double start = now();
+    for (int it = 0; it < iterations; ++it)
+    {
+        arm.forward();
+        double dx = tX - arm.tipX(), dy = tY - arm.tipY();
+        double d = sqrt(dx * dx + dy * dy);
+        if (d < 0.1)
+        {
+            targets.target(arm.reach(), tX, tY);
+            continue;
+        }
+        arm.solveStep(dx * 0.01 / d, dy * 0.01 / d);
+    }
+    return 1e9 * (now() - start) / iterations;
+}
+
+template <int N>
+void benchFixedSize()
+{
+    const int iterations = 400000;
+    vector<double> lengths = taperedLengths(N);
+    float lengthsF[N];
+    for (int i = 0; i < N; ++i)
+        lengthsF[i] = float(lengths[i]);
+
+    IKChain dynamic(lengths, -PI/4);
+    FixedIKChain<N, double> fixedD(&lengths[0], -PI/4);
+    FixedIKChain<N, float> fixedF(lengthsF, float(-PI/4));
+    double tDynamic = timeSteps(dynamic, iterations);
+    double tFixedD = timeSteps(fixedD, iterations);
+    double tFixedF = timeSteps(fixedF, iterations);
+
+    // Same start and targets, so the angles should agree to rounding
+    IKChain a(lengths, 0.2);
+    FixedIKChain<N, double> b(&lengths[0], 0.2);
+    timeSteps(a, 10000);
+    timeSteps(b, 10000);
+    double diff = 0;
+    for (int i = 0; i < N; ++i)
+        diff = max(diff, fabs(a.angle(i) - b.angle(i)));
+
+    char reference[32] = "-";
+    if (N == 4)
+    {
+        FourLinkReference ref = { { 25, 20, 15, 10 }, { -PI/4, -PI/4, -PI/4, -PI/4 } };
+        IKRandom targets;
+        double tX, tY, dist;
+        targets.target(70, tX, tY);
+        double start = now();
+        for (int it = 0; it < iterations; ++it)
+        {
+            ref.step(tX, tY, 0.01, dist);
+            if (dist < 0.1)
+                targets.target(70, tX, tY);
+        }
+        snprintf(reference, sizeof(reference), "%.1f", 1e9 * (now() - start) / iterations);
+    }
+    printf("%6d %12s %12.1f %12.1f %12.1f %12.3g\n", N, reference, tDynamic, tFixedD, tFixedF, diff);
+}
+
+template <int N>
+struct FixedSizes
+{
+    static void run()
+    {
+        FixedSizes<N - 1>::run();
+        benchFixedSize<N>();
+    }
+};
+
+template <>
+struct FixedSizes<1>
+{
+    static void run() {}
+};
+
+// Compile-time sized chains against the run-time sized IKChain and the
+// original hand-written four-link code
+void benchFixed()
+{
+    printf("fixed: ns per forward() + solveStep()\n");
+    printf("%6s %12s %12s %12s %12s %12s\n", "links", "hand 4-link", "IKChain", "Fixed<dbl>", "Fixed<flt>", "max diff");
+    FixedSizes<16>::run();
+}
+
+// Vectorised sincos against the library, and forward() after changing
+// the first joint (every link evaluated) or only the last one
+void benchForward()
+{
+    const int count = 1 << 20;
+    vector<double> theta(count), s(count), c(count);
+    IKRandom rng;
+    for (int i = 0; i < count; ++i)
+        theta[i] = 200 * (rng.real() - 0.5);
+
+    double start = now();
+    for (int i = 0; i < count; ++i)
+    {
+        s[i] = sin(theta[i]);
+        c[i] = cos(theta[i]);
+    }
+    double tLibrary = now() - start;
+    start = now();
+    sinCos(&theta[0], &s[0], &c[0], count);
+    double tSimd = now() - start;
+    double error = 0;
+    for (int i = 0; i < count; ++i)
+        error = max(error, max(fabs(s[i] - sin(theta[i])), fabs(c[i] - cos(theta[i]))));
+    printf("sincos (%s): std %.2f ns, simd %.2f ns per angle, max error %.3g\n",
+           simdName(), 1e9 * tLibrary / count, 1e9 * tSimd / count, error);
+
+    printf("%8s %14s %14s\n", "links", "joint 0 (ns)", "last (ns)");
+    const int sizes[] = { 4, 16, 64, 256, 1024 };
+    for (int t = 0; t < int(sizeof(sizes) / sizeof(sizes[0])); ++t)
+    {
+        int n = sizes[t];
+        IKChain arm(taperedLengths(n), 0.1);
+        arm.forward();
+        int iterations = 20000000 / n;
+        double result[2];
+        for (int which = 0; which < 2; ++which)
+        {
+            int joint = which ? n - 1 : 0;
+            start = now();
+            for (int it = 0; it < iterations; ++it)
+            {
+                arm.setAngle(joint, 0.1 + 1e-6 * (it & 1));
+                arm.forward();
+            }
+            result[which] = 1e9 * (now() - start) / iterations;
+        }
+        printf("%8d %14.1f %14.1f\n", n, result[0], result[1]);
+    }
+}
+
+// 3D chains alternating z, y and x hinges, solving for random reachable
+// poses from the previous solution, with and without the orientation
+void bench3D()
+{
+    printf("3d: random reachable poses, warm started, tolerance 0.1%% of reach and 1 mrad\n");
+    printf("%6s %12s %8s %8s %12s %8s %8s\n",
+           "joints", "poses/s", "iters", "failed", "positions/s", "iters", "failed");
+    const int sizes[] = { 6, 12, 24, 48 };
+    const int poses = 2000, maxIterations = 200;
+    for (int t = 0; t < int(sizeof(sizes) / sizeof(sizes[0])); ++t)
+    {
+        int n = sizes[t];
+        vector<double> lengths = taperedLengths(n);
+        vector<cugl::Vector> axes(n), offsets(n);
+        for (int i = 0; i < n; ++i)
+        {
+            axes[i] = cugl::Vector(i % 3 == 2, i % 3 == 1, i % 3 == 0);
+            offsets[i] = cugl::Vector(0, 0, GLfloat(lengths[i]));
+        }
+        IKChain3D source(&axes[0], &offsets[0], n);
+        IKChain3D arm(&axes[0], &offsets[0], n);
+        double tolerance = 1e-3 * arm.reach();
+
+        double rate[2], mean[2];
+        int failed[2];
+        for (int full = 1; full >= 0; --full)
+        {
+            IKRandom rng;
+            for (int i = 0; i < n; ++i)
+                arm.setAngle(i, 0);
+            long total = 0;
+            failed[full] = 0;
+            double elapsed = 0;
+            for (int k = 0; k < poses; ++k)
+            {
+                for (int i = 0; i < n; ++i)
+                    source.setAngle(i, 2 * rng.real() - 1);
+                source.forward();
+                double start = now();
+                int it = full ? arm.solve(source.tip(), source.tipOrientation(), tolerance, 1e-3, maxIterations)
+                              : arm.solve(source.tip(), tolerance, maxIterations);
+                elapsed += now() - start;
+                total += it;
+                if (it == maxIterations)
+                    ++failed[full];
+            }
+            rate[full] = poses / elapsed;
+            mean[full] = double(total) / poses;
+        }
+        printf("%6d %12.0f %8.1f %8d %12.0f %8.1f %8d\n",
+               n, rate[1], mean[1], failed[1], rate[0], mean[0], failed[0]);
+    }
+}
+
+// An 8-link arm whose joints after the base are limited to +-90 degrees,
+// with and without the null-space pull towards mid-range
+void benchLimits()
+{
+    const int n = 8, targets = 300, cap = 20000;
+    const double step = 0.1;
+    const double gains[] = { 0, 0.01, 0.05 };
+    printf("limits: %d links, joints 1-%d limited to +-90 degrees, %d targets, cap %d steps\n", n, n - 1, targets, cap);
+    printf("%-6s %6s %12s %8s %14s %10s %12s\n",
+           "method", "gain", "mean steps", "capped", "mean |a|/90", "at limit", "us/target");
+    for (int m = 0; m < 2; ++m)
+        for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); ++g)
+        {
+            IKChain arm(taperedLengths(n), 0.2);
+            arm.setMethod(m ? DAMPED_LEAST_SQUARES : PSEUDO_INVERSE);
+            for (int i = 1; i < n; ++i)
+                arm.setLimits(i, -PI/2, PI/2);
+            arm.setNullSpaceGain(gains[g]);
+            IKRandom rng;
+            long total = 0;
+            int capped = 0, atLimit = 0;
+            double offset = 0;
+            double start = now();
+            for (int t = 0; t < targets; ++t)
+            {
+                double tX, tY;
+                rng.target(arm.reach(), tX, tY);
+                int it = 0;
+                for (; it < cap; ++it)
+                {
+                    arm.forward();
+                    double dx = tX - arm.tipX(), dy = tY - arm.tipY();
+                    double d = sqrt(dx * dx + dy * dy);
+                    if (d < 0.1)
+                        break;
+                    double scale = min(step, d) / d;
+                    arm.solveStep(dx * scale, dy * scale);
+                }
+                total += it;
+                if (it == cap)
+                    ++capped;
+                for (int i = 1; i < n; ++i)
+                {
+                    offset += fabs(arm.angle(i)) / (PI/2);
+                    if (fabs(arm.angle(i)) >= PI/2)
+                        ++atLimit;
+                }
+            }
+            double elapsed = now() - start;
+            printf("%-6s %6.2f %12.1f %8d %14.3f %9.1f%% %12.1f\n", methodNames[arm.method()], gains[g],
+                   double(total) / targets, capped, offset / (targets * (n - 1)),
+                   100.0 * atLimit / (targets * (n - 1)), 1e6 * elapsed / targets);
+        }
+
+    // The trust region scales its own steps, and CCD and FABRIK have no
+    // null-space term; the limits act through setAngle() alone
+    JacobianSolver trustRegion(0.01, TRUST_REGION);
+    CCDSolver ccd;
+    FABRIKSolver fabrik;
+    IKSolver *solvers[] = { &trustRegion, &ccd, &fabrik };
+    for (int k = 0; k < 3; ++k)
+    {
+        IKChain arm(taperedLengths(n), 0.2);
+        for (int i = 1; i < n; ++i)
+            arm.setLimits(i, -PI/2, PI/2);
+        IKRandom rng;
+        long total = 0;
+        int capped = 0, atLimit = 0;
+        double offset = 0;
+        double start = now();
+        for (int t = 0; t < targets; ++t)
+        {
+            double tX, tY;
+            rng.target(arm.reach(), tX, tY);
+            int it = solvers[k]->solve(arm, tX, tY, 0.1, cap);
+            total += it;
+            if (it == cap)
+                ++capped;
+            for (int i = 1; i < n; ++i)
+            {
+                offset += fabs(arm.angle(i)) / (PI/2);
+                if (fabs(arm.angle(i)) >= PI/2)
+                    ++atLimit;
+            }
+        }
+        double elapsed = now() - start;
+        printf("%-6s %6s %12.1f %8d %14.3f %9.1f%% %12.1f\n", solvers[k]->name(), "-",
+               double(total) / targets, capped, offset / (targets * (n - 1)),
+               100.0 * atLimit / (targets * (n - 1)), 1e6 * elapsed / targets);
+    }
+}
+
+// A hand: a palm of three links and some fingers, all fingertips effectors
+void buildHand(IKTree & tree, int fingers, int fingerJoints)
+{
+    int palm = -1;
+    for (int i = 0; i < 3; ++i)
+        palm = tree.addJoint(palm, 10, i ? 0.1 : PI/2);
+    for (int f = 0; f < fingers; ++f)
+    {
+        int joint = palm;
+        for (int k = 0; k < fingerJoints; ++k)
+            joint = tree.addJoint(joint, 4.0 / (k + 1), k ? 0.2 : (f - (fingers - 1) / 2.0) * 0.3);
+        tree.addEffector(joint);
+    }
+}
+
+// The same damped step as IKTree::solveStep(), with J^T J dense
+void denseTreeStep(const IKTree & tree, const vector<double> & tX, const vector<double> & tY,
+                   double step, double lambda, vector<double> & a, vector<double> & delta)
+{
+    int n = tree.size();
+    fill(a.begin(), a.end(), 0.0);
+    fill(delta.begin(), delta.end(), 0.0);
+    vector<double> cx(n), cy(n);
+    for (int e = 0; e < tree.effectors(); ++e)
+    {
+        // Find the effector's joint: the one whose link end it is
+        int j = n - 1;
+        while (tree.endX(j) != tree.effectorX(e) || tree.endY(j) != tree.effectorY(e))
+            --j;
+        double x = tree.endX(j), y = tree.endY(j);
+        double dx = tX[e] - x, dy = tY[e] - y, d = sqrt(dx * dx + dy * dy);
+        if (d > step)
+        {
+            dx *= step / d;
+            dy *= step / d;
+        }
+        fill(cx.begin(), cx.end(), 0.0);
+        fill(cy.begin(), cy.end(), 0.0);
+        for (int k = j; k >= 0; k = tree.parent(k))
+        {
+            int p = tree.parent(k);
+            cx[k] = (p < 0 ? 0 : tree.endY(p)) - y;
+            cy[k] = x - (p < 0 ? 0 : tree.endX(p));
+        }
+        for (int r = 0; r < n; ++r)
+        {
+            delta[r] += cx[r] * dx + cy[r] * dy;
+            for (int c = 0; c <= r; ++c)
+                a[r * n + c] += cx[r] * cx[c] + cy[r] * cy[c];
+        }
+    }
+    for (int r = 0; r < n; ++r)
+        a[r * n + r] += lambda * lambda;
+    choleskyDecompose(&a[0], n);
+    choleskySolve(&a[0], n, &delta[0], &delta[0]);
+}
+
+// Sparse tree factorisation against dense normal equations on the same
+// stacked Jacobian, and convergence of a hand reaching with all fingers
+void benchTree()
+{
+    printf("tree: one step for all fingertips of a hand, sparse vs dense J^T J\n");
+    printf("%8s %8s %8s %12s %12s %10s %12s\n", "fingers", "joints", "effectors", "sparse (us)", "dense (us)", "speedup", "max diff");
+    const int shapes[][2] = { { 2, 3 }, { 5, 3 }, { 5, 6 }, { 10, 6 }, { 20, 10 }, { 40, 10 } };
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s)
+    {
+        IKTree tree;
+        buildHand(tree, shapes[s][0], shapes[s][1]);
+        int n = tree.size(), m = tree.effectors();
+        tree.forward();
+        vector<double> tX(m), tY(m);
+        for (int e = 0; e < m; ++e)
+        {
+            tX[e] = tree.effectorX(e) + 3;
+            tY[e] = tree.effectorY(e) - 2;
+            tree.setTarget(e, tX[e], tY[e]);
+        }
+        vector<double> start(n), a(n * n), delta(n);
+        for (int i = 0; i < n; ++i)
+            start[i] = tree.angle(i);
+
+        int repeats = max(1, 200000 / (n * n));
+        double t0 = now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            tree.solveStep(0.5);
+            for (int i = 0; i < n; ++i)
+                tree.setAngle(i, start[i]);
+        }
+        double tSparse = (now() - t0) / repeats;
+        int denseRepeats = max(1, repeats / n);
+        t0 = now();
+        for (int r = 0; r < denseRepeats; ++r)
+            denseTreeStep(tree, tX, tY, 0.5, 0.01 * tree.reach(), a, delta);
+        double tDense = (now() - t0) / denseRepeats;
+
+        tree.solveStep(0.5);
+        double diff = 0;
+        for (int i = 0; i < n; ++i)
+            diff = max(diff, fabs(tree.angle(i) - start[i] - delta[i]));
+        printf("%8d %8d %8d %12.2f %12.2f %10.1f %12.3g\n",
+               shapes[s][0], n, m, 1e6 * tSparse, 1e6 * tDense, tDense / tSparse, diff);
+    }
+
+    // Targets come from perturbing every joint, so all of them can be met at once
+    IKTree hand;
+    buildHand(hand, 5, 3);
+    int n = hand.size();
+    vector<double> saved(n);
+    IKRandom rng;
+    const int poses = 500;
+    long total = 0;
+    int capped = 0;
+    double t0 = now();
+    for (int p = 0; p < poses; ++p)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            saved[i] = hand.angle(i);
+            hand.setAngle(i, saved[i] + 0.6 * (rng.real() - 0.5));
+        }
+        hand.forward();
+        for (int e = 0; e < hand.effectors(); ++e)
+            hand.setTarget(e, hand.effectorX(e), hand.effectorY(e));
+        for (int i = 0; i < n; ++i)
+            hand.setAngle(i, saved[i]);
+        int it = hand.solve(0.5, 0.01, 1000);
+        total += it;
+        if (it == 1000)
+            ++capped;
+    }
+    printf("tree: 5-finger hand, %d reachable fingertip poses: %.1f steps mean, %d capped, %.1f us per pose\n",
+           poses, double(total) / poses, capped, 1e6 * (now() - t0) / poses);
+}
+
+// Solve one target per chain with damped least squares; the first eighth
+// of the chains start straight and reach for the edge of the workspace,
+// which takes thousands of steps, and the rest move their tip a little
+void benchThreads()
+{
+    const int chains = 2048, cap = 20000;
+    int most = max(4, int(thread::hardware_concurrency()));
+    printf("threads: %d 8-link chains, 1/8 near-singular in one block, %u hardware threads\n",
+           chains, thread::hardware_concurrency());
+    printf("%8s %14s %10s %14s %10s %10s\n", "threads", "static (ms)", "speedup", "stealing (ms)", "speedup", "stolen");
+    double serial = 0;
+    for (int threads = 1; threads <= most; threads *= 2)
+    {
+        double elapsed[2];
+        long stolen = 0;
+        for (int steal = 0; steal < 2; ++steal)
+        {
+            vector<IKChain> arms(chains, IKChain(taperedLengths(8), 0.1));
+            vector<double> tX(chains), tY(chains);
+            for (int c = 0; c < chains; ++c)
+            {
+                arms[c].setMethod(DAMPED_LEAST_SQUARES);
+                if (c < chains / 8)
+                {
+                    for (int i = 0; i < 8; ++i)
+                        arms[c].setAngle(i, 0);
+                    tX[c] = 0;
+                    tY[c] = arms[c].reach() - 0.5;
+                }
+                else
+                {
+                    arms[c].forward();
+                    tX[c] = arms[c].tipX() + 0.3;
+                    tY[c] = arms[c].tipY() - 0.3;
+                }
+            }
+            TaskPool pool(threads);
+            pool.setStealing(steal != 0);
+            double start = now();
+            pool.parallelFor(chains, [&](int c)
+            {
+                IKChain & arm = arms[c];
+                for (int it = 0; it < cap; ++it)
+                {
+                    arm.forward();
+                    double dx = tX[c] - arm.tipX(), dy = tY[c] - arm.tipY();
+                    double d = sqrt(dx * dx + dy * dy);
+                    if (d < 0.1)
+                        break;
+                    arm.solveStep(dx * 0.01 / d, dy * 0.01 / d);
+                }
+            });
+            elapsed[steal] = now() - start;
+            if (steal)
+                for (int w = 0; w < threads; ++w)
+                    stolen += pool.stolen(w);
+        }
+        if (threads == 1)
+            serial = elapsed[0];
+        printf("%8d %14.1f %10.2f %14.1f %10.2f %10ld\n", threads, 1e3 * elapsed[0], serial / elapsed[0],
+               1e3 * elapsed[1], serial / elapsed[1], stolen);
+    }
+}
+
+// forward() of very long chains, serial against the parallel prefix scan
+void benchScan()
+{
+    int hardware = max(1, int(thread::hardware_concurrency()));
+    const int pools[] = { 1, 2, 4, hardware };
+    printf("scan: ns per link for a full forward(), %d hardware threads\n", hardware);
+    printf("%8s %10s", "links", "serial");
+    for (int p = 0; p < 4; ++p)
+        printf(" %8d thr", pools[p]);
+    printf(" %12s\n", "diff/reach");
+    const int sizes[] = { 1000, 10000, 100000 };
+    for (int s = 0; s < 3; ++s)
+    {
+        int n = sizes[s];
+        vector<double> lengths(n, 1.0);
+        IKChain serial(lengths), parallel(lengths);
+        IKRandom rng;
+        for (int i = 0; i < n; ++i)
+        {
+            double a = 0.01 * (rng.real() - 0.5);
+            serial.setAngle(i, a);
+            parallel.setAngle(i, a);
+        }
+        int repeats = max(3, 20000000 / n / 10);
+        double start = now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            serial.setAngle(0, serial.angle(0));
+            serial.forward();
+        }
+        printf("%8d %10.2f", n, 1e9 * (now() - start) / repeats / n);
+        double diff = 0;
+        for (int p = 0; p < 4; ++p)
+        {
+            TaskPool pool(pools[p]);
+            start = now();
+            for (int r = 0; r < repeats; ++r)
+                parallel.forward(pool);
+            printf(" %12.2f", 1e9 * (now() - start) / repeats / n);
+            for (int i = 0; i < n; ++i)
+                diff = max(diff, max(fabs(serial.dxda(i) - parallel.dxda(i)), fabs(serial.dyda(i) - parallel.dyda(i))));
+        }
+        printf(" %12.3g\n", diff / serial.reach());
+    }
+}
+
+// Iterations per target of the demo arm when each target starts from a
+// workspace table, against the previous target's pose, by table resolution;
+// the time is per target with the line search
+void benchWarm()
+{
+    const int targets = 2000, cap = 20000;
+    const int resolutions[] = { 0, 8, 16, 32, 64, 128, 256 };
+    printf("warm: demo arm, %d targets, tolerance 0.1, cap %d iterations per target\n", targets, cap);
+    printf("%6s %10s %10s %12s %12s %12s %12s\n",
+           "grid", "bytes", "build ms", "start error", "pinv iters", "line iters", "line us");
+    for (int r = 0; r < 7; ++r)
+    {
+        IKChain arm(vector<double>(demoLengths, demoLengths + 4), -PI/4);
+        WorkspaceTable table;
+        double start = now();
+        if (resolutions[r])
+            table.build(arm, resolutions[r]);
+        double built = now() - start;
+
+        JacobianSolver fixed(0.01), line(0.01, LINE_SEARCH);
+        long total[2] = { 0, 0 };
+        double error = 0, elapsed = 0;
+        for (int s = 0; s < 2; ++s)
+        {
+            IKRandom rng;
+            start = now();
+            for (int k = 0; k < targets; ++k)
+            {
+                double tX, tY;
+                rng.target(arm.reach(), tX, tY);
+                table.warmStart(arm, tX, tY);
+                arm.forward();
+                if (s == 0)
+                    error += hypot(tX - arm.tipX(), tY - arm.tipY());
+                total[s] += (s ? line : fixed).solve(arm, tX, tY, 0.1, cap);
+            }
+            if (s == 1)
+                elapsed = now() - start;
+        }
+        if (resolutions[r])
+            printf("%6d", resolutions[r]);
+        else
+            printf("%6s", "none");
+        printf(" %10zu %10.2f %12.3g %12.1f %12.1f %12.2f\n", table.bytes(), 1e3 * built, error / targets,
+               double(total[0]) / targets, double(total[1]) / targets, 1e6 * elapsed / targets);
+    }
+}
+
+// Reachability maps of the demo arm with every joint after the base
+// limited to +-45 degrees: build time, classification cost, and the
+// iterations spent on random targets with and without screening
+void benchReach()
+{
+    const long samples = 1 << 21;
+    const int hardware = max(1, int(thread::hardware_concurrency()));
+    IKChain arm(vector<double>(demoLengths, demoLengths + 4), 0);
+    for (int i = 1; i < 4; ++i)
+        arm.setLimits(i, -PI / 4, PI / 4);
+
+    printf("reach: demo arm, joints limited to +-45 degrees, %ld samples\n", samples);
+    printf("%6s %10s %12s %12s %10s %14s\n", "grid", "bytes", "build ms 1", "build ms hw", "coverage", "ns/classify");
+    const int resolutions[] = { 64, 128, 256 };
+    ReachabilityMap map;
+    for (int r = 0; r < 3; ++r)
+    {
+        double elapsed[2];
+        for (int p = 0; p < 2; ++p)
+        {
+            TaskPool pool(p ? hardware : 1);
+            double start = now();
+            map.build(arm, resolutions[r], samples, pool);
+            elapsed[p] = now() - start;
+        }
+        IKRandom rng;
+        const int queries = 1000000;
+        vector<double> xs(queries), ys(queries);
+        for (int k = 0; k < queries; ++k)
+            rng.target(arm.reach(), xs[k], ys[k]);
+        int reachable = 0;
+        double start = now();
+        for (int k = 0; k < queries; ++k)
+            reachable += map.reachable(xs[k], ys[k]);
+        double classify = now() - start;
+        printf("%6d %10zu %12.1f %12.1f %10.3f %14.2f   (%d%% of targets reachable)\n", resolutions[r], map.bytes(),
+               1e3 * elapsed[0], 1e3 * elapsed[1], map.coverage(), 1e9 * classify / queries, reachable / (queries / 100));
+    }
+
+    const int targets = 300, cap = 5000;
+    const char *modes[] = { "none", "reject", "clamp" };
+    printf("%d targets, damped least squares with line search, cap %d iterations per target\n", targets, cap);
+    printf("%8s %12s %10s %10s %12s\n", "screen", "mean iters", "capped", "screened", "us/target");
+    for (int m = 0; m < 3; ++m)
+    {
+        IKChain chain(arm);
+        chain.setMethod(DAMPED_LEAST_SQUARES);
+        JacobianSolver solver(0.01, LINE_SEARCH);
+        IKRandom rng;
+        long total = 0;
+        int capped = 0, screened = 0;
+        double start = now();
+        for (int k = 0; k < targets; ++k)
+        {
+            double tX, tY;
+            rng.target(chain.reach(), tX, tY);
+            if (m > 0 && !map.reachable(tX, tY))
+            {
+                ++screened;
+                if (m == 2)
+                    map.clamp(tX, tY);
+                else
+                    while (!map.reachable(tX, tY))
+                        rng.target(chain.reach(), tX, tY);
+            }
+            int it = solver.solve(chain, tX, tY, 0.1, cap);
+            total += it;
+            if (it == cap)
+                ++capped;
+        }
+        printf("%8s %12.1f %10d %10d %12.2f\n", modes[m], double(total) / targets, capped, screened,
+               1e6 * (now() - start) / targets);
+    }
+}
+
+// A target moving around a figure of eight, one sample per frame: the
+// distance from the tip to each new sample before solving, and the
+// iterations to reach it, with and without leading the chain
+void benchTrack()
+{
+    const int frames = 20000, cap = 1000;
+    const double speeds[] = { 0.2, 1.0 };
+    const double noises[] = { 0, 0.05 };
+    struct Mode
+    {
+        const char *name;
+        double alpha, beta;
+    };
+    const Mode modes[] = { { "none", 0, 0 }, { "const-vel", 1, 1 }, { "alpha-beta", 0.8, 0.4 } };
+    printf("track: demo arm, DLS with line search, %d frames, tolerance 0.01\n", frames);
+    printf("%6s %6s %-11s %12s %12s %12s\n", "speed", "noise", "prediction", "start error", "mean iters", "us/frame");
+    for (int v = 0; v < 2; ++v)
+        for (int e = 0; e < 2; ++e)
+            for (int m = 0; m < 3; ++m)
+            {
+                IKChain arm(vector<double>(demoLengths, demoLengths + 4), -PI/4);
+                arm.setMethod(DAMPED_LEAST_SQUARES);
+                JacobianSolver solver(0.01, LINE_SEARCH);
+                TargetTracker tracker(modes[m].alpha, modes[m].beta);
+                IKRandom rng;
+                long total = 0;
+                double error = 0;
+                double start = now();
+                for (int k = 0; k < frames; ++k)
+                {
+                    // Arc length per frame is roughly the speed
+                    double t = speeds[v] * k / 35;
+                    double x = 35 * sin(t) + noises[e] * (rng.real() - 0.5);
+                    double y = 20 * sin(2 * t) + 10 + noises[e] * (rng.real() - 0.5);
+                    arm.forward();
+                    error += hypot(x - arm.tipX(), y - arm.tipY());
+                    total += solver.solve(arm, x, y, 0.01, cap);
+                    if (m > 0)
+                    {
+                        tracker.observe(x, y);
+                        leadTarget(arm, tracker);
+                    }
+                }
+                printf("%6g %6g %-11s %12.4f %12.2f %12.2f\n", speeds[v], noises[e], modes[m].name, error / frames,
+                       double(total) / frames, 1e6 * (now() - start) / frames);
+            }
+}
+
+// Offline posing to a tight tolerance: the adaptive Jacobian engines
+// against Levenberg-Marquardt and Gauss-Newton, and the residuals of one
+// Levenberg-Marquardt solve
+void benchLM()
+{
+    const int targets = 1000, cap = 500;
+    const double tolerance = 1e-6;
+    const char *names[] = { "jacobian-ls", "jacobian-tr", "lm", "gauss-newton" };
+    const int sizes[] = { 4, 12, 40 };
+    printf("lm: %d random targets from the previous pose, tolerance %g, cap %d iterations\n", targets, tolerance, cap);
+    printf("%6s %-13s %12s %10s %8s %10s %12s\n", "links", "solver", "mean iters", "max iters", "capped", "rejected", "us/target");
+    for (int s = 0; s < 3; ++s)
+        for (int e = 0; e < 4; ++e)
+        {
+            int n = sizes[s];
+            IKChain arm(n == 4 ? vector<double>(demoLengths, demoLengths + 4) : taperedLengths(n), -PI/4);
+            arm.setMethod(DAMPED_LEAST_SQUARES);
+            IKSolver *solver = newSolver(names[e]);
+            LevenbergMarquardtSolver *lm = dynamic_cast<LevenbergMarquardtSolver *>(solver);
+            IKRandom rng;
+            long total = 0, rejected = 0;
+            int worst = 0, capped = 0;
+            double start = now();
+            for (int k = 0; k < targets; ++k)
+            {
+                double tX, tY;
+                rng.target(arm.reach(), tX, tY);
+                int it = solver->solve(arm, tX, tY, tolerance, cap);
+                total += it;
+                worst = max(worst, it);
+                capped += it == cap;
+                rejected += lm ? lm->stats().rejected : 0;
+            }
+            printf("%6d %-13s %12.2f %10d %8d %10.2f %12.2f\n", n, names[e], double(total) / targets, worst, capped,
+                   double(rejected) / targets, 1e6 * (now() - start) / targets);
+            delete solver;
+        }
+
+    IKChain arm(vector<double>(demoLengths, demoLengths + 4), -PI/4);
+    LevenbergMarquardtSolver lm;
+    lm.solve(arm, 30, 40, 1e-12, 50);
+    const ConvergenceStats & stats = lm.stats();
+    printf("lm residuals for (30, 40) from -pi/4, %d steps, %d rejected, %.2f us:", stats.iterations, stats.rejected,
+           1e6 * stats.seconds);
+    for (size_t k = 0; k < stats.residuals.size(); ++k)
+        printf(" %.3g", stats.residuals[k]);
+    printf("\n");
+}
+
+// A link as main.cpp used to keep it: a heap node with pointers to its children
+struct LinkNode
+{
+    double length, angle;
+    double world[16];
+    vector<LinkNode *> children;
+};
+
+// World transforms of a subtree, recursively, with the same arithmetic as LinkHierarchy::update()
+void updateNode(LinkNode *node, const double *w, double l)
+{
+    double c = cos(node->angle), s = sin(node->angle);
+    double *m = node->world;
+    for (int r = 0; r < 3; ++r)
+    {
+        m[r] = w[r];
+        m[4 + r] = c * w[4 + r] + s * w[8 + r];
+        m[8 + r] = c * w[8 + r] - s * w[4 + r];
+        m[12 + r] = w[12 + r] + l * w[8 + r];
+    }
+    m[3] = m[7] = m[11] = 0;
+    m[15] = 1;
+    for (size_t k = 0; k < node->children.size(); ++k)
+        updateNode(node->children[k], m, node->length);
+}
+
+// World transforms of a chain and of random trees, by recursion over heap
+// nodes allocated in random order and by one pass over the flat arrays
+void benchHierarchy()
+{
+    const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    struct Shape
+    {
+        const char *name;
+        int links;
+        bool chain;
+    };
+    const Shape shapes[] = { { "chain", 4, true }, { "chain", 10000, true }, { "tree", 100000, false }, { "tree", 1000000, false } };
+    printf("hierarchy: ns per link for all world transforms\n");
+    printf("%-6s %8s %12s %12s %12s\n", "shape", "links", "pointers", "flat", "difference");
+    for (int h = 0; h < 4; ++h)
+    {
+        int n = shapes[h].links;
+        IKRandom rng;
+        vector<int> parents(n);
+        for (int i = 0; i < n; ++i)
+            parents[i] = i == 0 ? -1 : shapes[h].chain ? i - 1 : int(rng.real() * i);
+
+        // Heap nodes in shuffled order, as a rig built up over time would be
+        vector<int> order(n);
+        for (int i = 0; i < n; ++i)
+            order[i] = i;
+        for (int i = n - 1; i > 0; --i)
+            swap(order[i], order[int(rng.real() * (i + 1))]);
+        vector<LinkNode *> nodes(n);
+        for (int k = 0; k < n; ++k)
+            nodes[order[k]] = new LinkNode;
+        LinkHierarchy flat;
+        for (int i = 0; i < n; ++i)
+        {
+            double length = 1 + rng.real(), angle = rng.real() - 0.5;
+            nodes[i]->length = length;
+            nodes[i]->angle = angle;
+            if (i > 0)
+                nodes[parents[i]]->children.push_back(nodes[i]);
+            flat.add(parents[i], length, angle);
+        }
+
+        int repeats = max(3, 20000000 / n);
+        double start = now();
+        for (int r = 0; r < repeats; ++r)
+            updateNode(nodes[0], identity, 0);
+        double pointers = now() - start;
+        // Turning the root away and back leaves every link to recompute
+        double root = flat.angle(0);
+        start = now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            flat.setAngle(0, root + 1);
+            flat.setAngle(0, root);
+            flat.update();
+        }
+        double arrays = now() - start;
+
+        double diff = 0;
+        for (int i = 0; i < n; ++i)
+            for (int k = 0; k < 16; ++k)
+                diff = max(diff, fabs(nodes[i]->world[k] - flat.world(i)[k]));
+        printf("%-6s %8d %12.2f %12.2f %12.3g\n", shapes[h].name, n, 1e9 * pointers / repeats / n,
+               1e9 * arrays / repeats / n, diff);
+        for (int i = 0; i < n; ++i)
+            delete nodes[i];
+    }
+
+    // Incremental updates: a frame moves one joint, or none once the target is reached
+    printf("\nhierarchy: ns per update() and links updated when one joint moves\n");
+    printf("%-6s %8s %-8s %12s %10s\n", "shape", "links", "moved", "ns", "updated");
+    for (int h = 0; h < 4; ++h)
+    {
+        int n = shapes[h].links;
+        IKRandom rng;
+        LinkHierarchy flat;
+        for (int i = 0; i < n; ++i)
+            flat.add(i == 0 ? -1 : shapes[h].chain ? i - 1 : int(rng.real() * i), 1 + rng.real(), rng.real() - 0.5);
+        flat.update();
+
+        const char *moved[] = { "root", "middle", "last", "nothing" };
+        const int joints[] = { 0, n / 2, n - 1, -1 };
+        for (int m = 0; m < 4; ++m)
+        {
+            int j = joints[m];
+            int repeats = max(3, 20000000 / n), updated = 0;
+            double start = now();
+            for (int r = 0; r < repeats; ++r)
+            {
+                if (j >= 0)
+                    flat.setAngle(j, flat.angle(j) + (r & 1 ? -1e-3 : 1e-3));
+                flat.update();
+                updated = int(flat.updatedLinks().size());
+            }
+            double elapsed = now() - start;
+            printf("%-6s %8d %-8s %12.1f %10d\n", shapes[h].name, n, moved[m], 1e9 * elapsed / repeats, updated);
+        }
+    }
+}
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)();
+};
+
+const Benchmark benchmarks[] =
+{
+    { "chain", benchChain },
+    { "batch", benchBatch },
+    { "damping", benchDamping },
+    { "solvers", benchSolvers },
+    { "stepping", benchStepping },
+    { "fixed", benchFixed },
+    { "forward", benchForward },
+    { "3d", bench3D },
+    { "limits", benchLimits },
+    { "tree", benchTree },
+    { "threads", benchThreads },
+    { "scan", benchScan },
+    { "warm", benchWarm },
+    { "reach", benchReach },
+    { "track", benchTrack },
+    { "lm", benchLM },
+    { "hierarchy", benchHierarchy }
+};
+
+int main(int argc, char *argv[])
+{
+    const int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    for (int b = 0; b < count; ++b)
+    {
+        bool selected = argc < 2;
+        for (int a = 1; a < argc; ++a)
+            if (strcmp(argv[a], benchmarks[b].name) == 0)
+                selected = true;
+        if (selected)
+        {
+            printf("== %s ==\n", benchmarks[b].name);
+            benchmarks[b].run();
+        }
+    }
+    return 0;
+}
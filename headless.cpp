@@ -0,0 +1,272 @@
+// Drive an IK engine without a window.
+
+#include "include/headless.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Index of the histogram bucket for a target that took n iterations
+static int bucket(long n)
+{
+    int k = 0;
+    while (n > 1)
+    {
+        n >>= 1;
+        ++k;
+    }
+    return k;
+}
+
+// The p-th percentile of the latencies, which are reordered
+static double percentile(vector<double> & values, double p)
+{
+    if (values.empty())
+        return 0;
+    size_t k = min(values.size() - 1, size_t(p * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+// Draw the next target, screen it against the reachability map and warm start the chain
+static void nextTarget(IKChain & chain, IKRandom & rng, const HeadlessOptions & options, HeadlessReport & report,
+                       double & tX, double & tY)
+{
+    rng.target(chain.reach(), tX, tY);
+    if (options.reach && !options.reach->reachable(tX, tY))
+    {
+        ++report.screened;
+        if (options.clampTargets)
+            options.reach->clamp(tX, tY);
+        else
+            for (int tries = 0; tries < 1000 && !options.reach->reachable(tX, tY); ++tries)
+                rng.target(chain.reach(), tX, tY);
+    }
+    if (options.table)
+        options.table->warmStart(chain, tX, tY);
+    if (options.recorder)
+        options.recorder->target(tX, tY, chain);
+}
+
+HeadlessReport runHeadless(IKChain & chain, IKSolver & solver, IKRandom & rng, const HeadlessOptions & options)
+{
+    HeadlessReport report;
+    report.solver = solver.name();
+    report.method = methodNames[chain.method()];
+    report.links = chain.size();
+    report.seed = options.seed;
+    report.steps = 0;
+    report.reached = 0;
+    report.abandoned = 0;
+    report.singularities = 0;
+    report.screened = 0;
+
+    vector<double> latencies;
+    latencies.reserve(options.steps > 0 ? options.steps : 1 << 20);
+
+    if (options.recorder)
+        options.recorder->solver(solver.name(), chain);
+    double tX, tY;
+    nextTarget(chain, rng, options, report, tX, tY);
+    long iterations = 0;
+    Clock::time_point start = Clock::now();
+    while ((options.targets == 0 || report.reached + report.abandoned < options.targets) &&
+           (options.steps == 0 || report.steps < options.steps))
+    {
+        Clock::time_point begin = Clock::now();
+        chain.forward();
+        double dx = tX - chain.tipX(), dy = tY - chain.tipY();
+        if (dx * dx + dy * dy < options.tolerance * options.tolerance || iterations >= options.maxIterations)
+        {
+            if (iterations < options.maxIterations)
+            {
+                ++report.reached;
+                int k = bucket(iterations);
+                if (int(report.histogram.size()) <= k)
+                    report.histogram.resize(k + 1);
+                ++report.histogram[k];
+            }
+            else
+                ++report.abandoned;
+            nextTarget(chain, rng, options, report, tX, tY);
+            iterations = 0;
+            continue;
+        }
+        if (!solver.iterate(chain, tX, tY))
+            ++report.singularities;
+        latencies.push_back(chrono::duration<double, nano>(Clock::now() - begin).count());
+        if (options.recorder)
+            options.recorder->step(chain, long(latencies.back()));
+        ++report.steps;
+        ++iterations;
+    }
+    report.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    report.p50 = percentile(latencies, 0.50);
+    report.p99 = percentile(latencies, 0.99);
+    report.worst = latencies.empty() ? 0 : *max_element(latencies.begin(), latencies.end());
+    return report;
+}
+
+void printReport(ostream & os, const HeadlessReport & r, bool json)
+{
+    double stepRate = r.seconds > 0 ? r.steps / r.seconds : 0;
+    double targetRate = r.seconds > 0 ? r.reached / r.seconds : 0;
+    if (json)
+    {
+        os << "{\"solver\": \"" << r.solver << "\", \"method\": \"" << r.method << "\", "
+           << "\"links\": " << r.links << ", \"seed\": " << r.seed << ", "
+           << "\"steps\": " << r.steps << ", \"targets_reached\": " << r.reached << ", "
+           << "\"targets_abandoned\": " << r.abandoned << ", \"singularities\": " << r.singularities << ", "
+           << "\"targets_screened\": " << r.screened << ", "
+           << "\"seconds\": " << r.seconds << ", \"steps_per_second\": " << stepRate << ", "
+           << "\"targets_per_second\": " << targetRate << ", "
+           << "\"step_latency_ns\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"max\": " << r.worst << "}, "
+           << "\"iterations_histogram\": [";
+        for (size_t k = 0; k < r.histogram.size(); ++k)
+            os << (k ? ", " : "") << "{\"min\": " << (k ? 1L << k : 0L) << ", \"max\": " << (1L << (k + 1)) - 1
+               << ", \"count\": " << r.histogram[k] << "}";
+        os << "]}" << endl;
+        return;
+    }
+
+    os << "solver " << r.solver << ", method " << r.method << ", " << r.links << " links, seed " << r.seed << endl
+       << "steps " << r.steps << ", targets reached " << r.reached << ", abandoned " << r.abandoned
+       << ", singularities " << r.singularities << ", screened " << r.screened << endl
+       << "time " << r.seconds << " s, " << stepRate << " steps/s, " << targetRate << " targets/s" << endl
+       << "step latency p50 " << r.p50 << " ns, p99 " << r.p99 << " ns, max " << r.worst << " ns" << endl
+       << "iterations per target:" << endl;
+    long most = r.histogram.empty() ? 0 : *max_element(r.histogram.begin(), r.histogram.end());
+    for (size_t k = 0; k < r.histogram.size(); ++k)
+    {
+        long lo = k ? 1L << k : 0L, hi = (1L << (k + 1)) - 1;
+        os << setw(8) << lo << " - " << setw(8) << left << hi << right << setw(8) << r.histogram[k] << ' '
+           << string(most ? 40 * r.histogram[k] / most : 0, '#') << endl;
+    }
+}
+
+ReplayReport runReplay(SessionReader & log)
+{
+    const SessionHeader & head = log.header();
+    int n = int(head.lengths.size());
+    IKChain chain(head.lengths);
+    for (int i = 0; i < n; ++i)
+        chain.setLimits(i, head.lower[i], head.upper[i]);
+    chain.setNullSpaceGain(head.nullGain);
+
+    ReplayReport report;
+    report.links = n;
+    report.seed = head.seed;
+    report.targets = 0;
+    report.steps = 0;
+    report.complete = true;
+    report.mismatches = 0;
+    report.firstMismatch = -1;
+    report.deviation = 0;
+    report.slowest = -1;
+    report.slowestReplayed = 0;
+
+    vector<double> recorded, replayed;
+    IKSolver *solver = 0;
+    double tX = 0, tY = 0;
+    SessionEvent e;
+    while (log.next(e))
+    {
+        if (e.type == 'M')
+        {
+            delete solver;
+            solver = newSolver(e.solver);
+            chain.setMethod(IKMethod(e.method));
+            report.solver = e.solver;
+        }
+        else if (e.type == 'T')
+        {
+            tX = e.x;
+            tY = e.y;
+            for (int i = 0; i < n; ++i)
+                chain.setAngle(i, e.angles[i]);
+            ++report.targets;
+        }
+        if (e.type == 'T' || e.type == 'M')
+        {
+            if (solver)
+                continue;
+            report.complete = false;
+            break;
+        }
+
+        // A step before any solver was named cannot be replayed
+        if (!solver)
+        {
+            report.complete = false;
+            break;
+        }
+
+        // The same work as one iteration of runHeadless()
+        Clock::time_point begin = Clock::now();
+        chain.forward();
+        solver->iterate(chain, tX, tY);
+        replayed.push_back(chrono::duration<double, nano>(Clock::now() - begin).count());
+        recorded.push_back(double(e.nanoseconds));
+        if (report.slowest < 0 || e.nanoseconds > recorded[report.slowest])
+        {
+            report.slowest = report.steps;
+            report.slowestReplayed = replayed.back();
+        }
+
+        bool same = true;
+        for (int i = 0; i < n; ++i)
+        {
+            same = same && llabs(log.quantise(chain.angle(i)) - e.quantised[i]) <= 1;
+            report.deviation = max(report.deviation, fabs(chain.angle(i) - e.angles[i]));
+        }
+        if (!same && report.mismatches++ == 0)
+            report.firstMismatch = report.steps;
+        ++report.steps;
+    }
+    delete solver;
+    report.complete = report.complete && !log.truncated();
+
+    report.recordedWorst = recorded.empty() ? 0 : *max_element(recorded.begin(), recorded.end());
+    report.worst = replayed.empty() ? 0 : *max_element(replayed.begin(), replayed.end());
+    report.recordedP50 = percentile(recorded, 0.50);
+    report.recordedP99 = percentile(recorded, 0.99);
+    report.p50 = percentile(replayed, 0.50);
+    report.p99 = percentile(replayed, 0.99);
+    return report;
+}
+
+void printReplay(ostream & os, const ReplayReport & r, bool json)
+{
+    if (json)
+    {
+        os << "{\"solver\": \"" << r.solver << "\", \"links\": " << r.links << ", \"seed\": " << r.seed << ", "
+           << "\"targets\": " << r.targets << ", \"steps\": " << r.steps << ", "
+           << "\"complete\": " << (r.complete ? "true" : "false") << ", "
+           << "\"mismatches\": " << r.mismatches << ", \"first_mismatch\": " << r.firstMismatch << ", "
+           << "\"max_deviation\": " << r.deviation << ", "
+           << "\"recorded_latency_ns\": {\"p50\": " << r.recordedP50 << ", \"p99\": " << r.recordedP99
+           << ", \"max\": " << r.recordedWorst << "}, "
+           << "\"replayed_latency_ns\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"max\": " << r.worst << "}, "
+           << "\"slowest_step\": {\"index\": " << r.slowest << ", \"recorded_ns\": " << r.recordedWorst
+           << ", \"replayed_ns\": " << r.slowestReplayed << "}}" << endl;
+        return;
+    }
+
+    os << "replay of solver " << r.solver << ", " << r.links << " links, seed " << r.seed
+       << (r.complete ? "" : " (recording truncated)") << endl
+       << "targets " << r.targets << ", steps " << r.steps << ", mismatched steps " << r.mismatches;
+    if (r.mismatches)
+        os << " (first at step " << r.firstMismatch << ")";
+    os << ", max deviation " << r.deviation << " rad" << endl
+       << "recorded latency p50 " << r.recordedP50 << " ns, p99 " << r.recordedP99 << " ns, max " << r.recordedWorst << " ns" << endl
+       << "replayed latency p50 " << r.p50 << " ns, p99 " << r.p99 << " ns, max " << r.worst << " ns" << endl
+       << "slowest recorded step " << r.slowest << ": " << r.recordedWorst << " ns recorded, "
+       << r.slowestReplayed << " ns replayed" << endl;
+}
@@ -0,0 +1,156 @@
+// Batched inverse kinematics for many identical planar arms.
+
+#include "include/ikbatch.h"
+#include "include/iksimd.h"
+
+#include <cmath>
+
+using namespace std;
+
+// Arms are solved a tile at a time so that the per-joint scratch arrays
+// stay in cache while the tile runs all of its steps.
+const int tileArms = 32;
+
+ChainBatch::ChainBatch(const double lengths[], int links, int arms, double initialAngle)
+    : n(links), count(arms), stride((arms + tileArms - 1) / tileArms * tileArms),
+      lengths(lengths, lengths + links),
+      angles(links * stride, initialAngle), oldDelta(links * stride, 0),
+      targetX(tileArms), targetY(tileArms),
+      sines(links * tileArms), cosines(links * tileArms),
+      jx(links * tileArms), jy(links * tileArms), distance(tileArms)
+{}
+
+void ChainBatch::tip(int arm, double & x, double & y) const
+{
+    double theta = 0;
+    x = 0;
+    y = 0;
+    for (int j = 0; j < n; ++j)
+    {
+        theta += angles[j * stride + arm];
+        x += lengths[j] * cos(theta);
+        y += lengths[j] * sin(theta);
+    }
+}
+
+double ChainBatch::reach() const
+{
+    double sum = 0;
+    for (int j = 0; j < n; ++j)
+        sum += lengths[j];
+    return sum;
+}
+
+int solveBatch(ChainBatch & b, const double tX[], const double tY[],
+               int steps, double step, double tolerance)
+{
+    const int W = SimdReal::width;
+    const int n = b.n;
+    const SimdReal zero(0.0);
+    const SimdReal stepSize(step);
+    const SimdReal tol(tolerance);
+    int reached = 0;
+
+    for (int base = 0; base < b.stride; base += tileArms)
+    {
+        // Lanes past the last arm duplicate it so that every lane does valid work
+        for (int k = 0; k < tileArms; ++k)
+        {
+            int arm = base + k < b.count ? base + k : b.count - 1;
+            b.targetX[k] = tX[arm];
+            b.targetY[k] = tY[arm];
+            if (arm != base + k)
+                for (int j = 0; j < n; ++j)
+                {
+                    b.angles[j * b.stride + base + k] = b.angles[j * b.stride + arm];
+                    b.oldDelta[j * b.stride + base + k] = b.oldDelta[j * b.stride + arm];
+                }
+        }
+
+        for (int s = 0; ; ++s)
+        {
+            // Cumulative joint angles
+            for (int g = 0; g < tileArms; g += W)
+            {
+                SimdReal theta = zero;
+                for (int j = 0; j < n; ++j)
+                {
+                    theta = theta + SimdReal::load(&b.angles[j * b.stride + base + g]);
+                    theta.store(&b.cosines[j * tileArms + g]);
+                }
+            }
+            sinCos(&b.cosines[0], &b.sines[0], &b.cosines[0], n * tileArms);
+
+            bool done = true;
+            for (int g = 0; g < tileArms; g += W)
+            {
+                // Tip position and each link's contribution to the Jacobian
+                SimdReal x = zero, y = zero;
+                for (int j = 0; j < n; ++j)
+                {
+                    int k = j * tileArms + g;
+                    SimdReal len(b.lengths[j]);
+                    SimdReal lc = len * SimdReal::load(&b.cosines[k]);
+                    SimdReal ls = len * SimdReal::load(&b.sines[k]);
+                    x = x + lc;
+                    y = y + ls;
+                    (zero - ls).store(&b.jx[k]);
+                    lc.store(&b.jy[k]);
+                }
+
+                SimdReal deltaX = SimdReal::load(&b.targetX[g]) - x;
+                SimdReal deltaY = SimdReal::load(&b.targetY[g]) - y;
+                SimdReal dist = sqrt(deltaX * deltaX + deltaY * deltaY);
+                dist.store(&b.distance[g]);
+                SimdMask close = dist < tol;
+                if (!all(close))
+                    done = false;
+                if (s == steps)
+                    continue;
+
+                // Suffix sums give the Jacobian columns; accumulate J J^T as we go
+                SimdReal a = zero, c = zero, d = zero;
+                SimdReal colX = zero, colY = zero;
+                for (int j = n - 1; j >= 0; --j)
+                {
+                    int k = j * tileArms + g;
+                    colX = colX + SimdReal::load(&b.jx[k]);
+                    colY = colY + SimdReal::load(&b.jy[k]);
+                    colX.store(&b.jx[k]);
+                    colY.store(&b.jy[k]);
+                    a = a + colX * colX;
+                    c = c + colX * colY;
+                    d = d + colY * colY;
+                }
+
+                SimdReal det = a * d - c * c;
+                SimdMask singular = det == zero;
+                SimdReal rd = stepSize / dist;
+                deltaX = deltaX * rd;
+                deltaY = deltaY * rd;
+                SimdReal wx = (d * deltaX - c * deltaY) / det;
+                SimdReal wy = (a * deltaY - c * deltaX) / det;
+
+                // Arms that have arrived do not move; singular arms repeat their last increment
+                for (int j = 0; j < n; ++j)
+                {
+                    int k = j * tileArms + g;
+                    double *angle = &b.angles[j * b.stride + base + g];
+                    double *old = &b.oldDelta[j * b.stride + base + g];
+                    SimdReal previous = SimdReal::load(old);
+                    SimdReal delta = SimdReal::load(&b.jx[k]) * wx + SimdReal::load(&b.jy[k]) * wy;
+                    delta = select(singular, previous, delta);
+                    select(close, previous, delta).store(old);
+                    (SimdReal::load(angle) + select(close, zero, delta)).store(angle);
+                }
+            }
+            if (done || s == steps)
+                break;
+        }
+
+        for (int k = 0; k < tileArms && base + k < b.count; ++k)
+            if (b.distance[k] < tolerance)
+                ++reached;
+    }
+    return reached;
+}
@@ -0,0 +1,282 @@
+// Planar inverse kinematics for a serial chain with any number of links.
+
+#include "include/ikchain.h"
+#include "include/iklinalg.h"
+#include "include/iksimd.h"
+#include "include/iktask.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const char *methodNames[] = { "pinv", "dls", "svd", 0 };
+
+IKChain::IKChain(const double lengths[], int n, double initialAngle)
+    : n(n), x(0), y(0), ikMethod(PSEUDO_INVERSE), lambda(0), nullGain(0), limited(false), firstChanged(0),
+      lengths(lengths, lengths + n), angles(n, initialAngle)
+{
+    allocate();
+}
+
+IKChain::IKChain(const vector<double> & lengths, double initialAngle)
+    : n(int(lengths.size())), x(0), y(0), ikMethod(PSEUDO_INVERSE), lambda(0), nullGain(0), limited(false), firstChanged(0),
+      lengths(lengths), angles(lengths.size(), initialAngle)
+{
+    allocate();
+}
+
+void IKChain::allocate()
+{
+    theta.assign(n, 0);
+    sines.assign(n, 0);
+    cosines.assign(n, 0);
+    px.assign(n + 1, 0);
+    py.assign(n + 1, 0);
+    jx.assign(n, 0);
+    jy.assign(n, 0);
+    oldDelta.assign(n, 0);
+    lower.assign(n, -HUGE_VAL);
+    upper.assign(n, HUGE_VAL);
+    nullStep.assign(n, 0);
+    jacobian.assign(2 * n, 0);
+    svdWork.assign(svdWorkSize(2, n), 0);
+    setDamping(0.02 * reach(), 0.01 * reach());
+}
+
+void IKChain::setDamping(double threshold, double maxLambda)
+{
+    dampingThreshold = threshold;
+    maxDamping = maxLambda;
+}
+
+double IKChain::adaptiveDamping(double sigmaMin) const
+{
+    if (sigmaMin >= dampingThreshold)
+        return 0;
+    double r = sigmaMin / dampingThreshold;
+    return maxDamping * sqrt(1 - r * r);
+}
+
+void IKChain::setLimits(int i, double lo, double hi)
+{
+    lower[i] = lo;
+    upper[i] = hi;
+    setAngle(i, angles[i]);
+    limited = false;
+    for (int k = 0; k < n; ++k)
+        limited = limited || lower[k] != -HUGE_VAL || upper[k] != HUGE_VAL;
+}
+
+double IKChain::centring(int i) const
+{
+    if (lower[i] == -HUGE_VAL || upper[i] == HUGE_VAL)
+        return 0;
+    return -nullGain * (angles[i] - (lower[i] + upper[i]) / 2);
+}
+
+void IKChain::applyDelta()
+{
+    firstChanged = 0;
+    if (!limited)
+    {
+        for (int i = 0; i < n; ++i)
+            angles[i] += oldDelta[i];
+        return;
+    }
+
+    // oldDelta is left holding the increments that survived the limits
+    for (int i = 0; i < n; ++i)
+    {
+        double a = min(max(angles[i] + oldDelta[i], lower[i]), upper[i]);
+        oldDelta[i] = a - angles[i];
+        angles[i] = a;
+    }
+}
+
+double IKChain::reach() const
+{
+    double sum = 0;
+    for (int i = 0; i < n; ++i)
+        sum += lengths[i];
+    return sum;
+}
+
+void IKChain::forward()
+{
+    // Links before the first changed joint keep their cached angles and positions
+    int first = firstChanged;
+    for (int i = first; i < n; ++i)
+        theta[i] = (i ? theta[i - 1] : 0) + angles[i];
+    sinCos(&theta[first], &sines[first], &cosines[first], n - first);
+    for (int i = first; i < n; ++i)
+    {
+        px[i + 1] = px[i] + lengths[i] * cosines[i];
+        py[i + 1] = py[i] + lengths[i] * sines[i];
+    }
+    firstChanged = n;
+    x = px[n];
+    y = py[n];
+
+    // Column i is the tip relative to joint i, rotated by 90 degrees
+    for (int i = 0; i < n; ++i)
+    {
+        jx[i] = py[i] - y;
+        jy[i] = x - px[i];
+    }
+}
+
+void IKChain::forward(TaskPool & pool)
+{
+    // Blocks of links are scanned in parallel; the serial work is one pass over the block totals
+    const int blocks = max(1, min(n, 4 * pool.threads()));
+    blockTotals.resize(3 * blocks);
+    double *thetaTotal = &blockTotals[0], *xTotal = &blockTotals[blocks], *yTotal = &blockTotals[2 * blocks];
+
+    pool.parallelFor(blocks, [&](int b)
+    {
+        double t = 0;
+        for (int i = b * n / blocks; i < (b + 1) * n / blocks; ++i)
+        {
+            t += angles[i];
+            theta[i] = t;
+        }
+        thetaTotal[b] = t;
+    });
+    double offset = 0;
+    for (int b = 0; b < blocks; ++b)
+    {
+        double t = thetaTotal[b];
+        thetaTotal[b] = offset;
+        offset += t;
+    }
+
+    pool.parallelFor(blocks, [&](int b)
+    {
+        int begin = b * n / blocks, end = (b + 1) * n / blocks;
+        for (int i = begin; i < end; ++i)
+            theta[i] += thetaTotal[b];
+        sinCos(&theta[begin], &sines[begin], &cosines[begin], end - begin);
+        double sx = 0, sy = 0;
+        for (int i = begin; i < end; ++i)
+        {
+            sx += lengths[i] * cosines[i];
+            sy += lengths[i] * sines[i];
+            px[i + 1] = sx;
+            py[i + 1] = sy;
+        }
+        xTotal[b] = sx;
+        yTotal[b] = sy;
+    });
+    double ox = 0, oy = 0;
+    for (int b = 0; b < blocks; ++b)
+    {
+        double tx = xTotal[b], ty = yTotal[b];
+        xTotal[b] = ox;
+        yTotal[b] = oy;
+        ox += tx;
+        oy += ty;
+    }
+    x = ox;
+    y = oy;
+
+    // px[begin] belongs to the previous block, but equals this block's offset exactly
+    pool.parallelFor(blocks, [&](int b)
+    {
+        int begin = b * n / blocks, end = (b + 1) * n / blocks;
+        for (int i = begin; i < end; ++i)
+        {
+            px[i + 1] += xTotal[b];
+            py[i + 1] += yTotal[b];
+        }
+        for (int i = begin; i < end; ++i)
+        {
+            double bx = i == begin ? xTotal[b] : px[i];
+            double by = i == begin ? yTotal[b] : py[i];
+            jx[i] = by - y;
+            jy[i] = x - bx;
+        }
+    });
+    firstChanged = n;
+}
+
+bool IKChain::solveStep(double dx, double dy)
+{
+    if (ikMethod == SVD)
+    {
+        // General m x n route: decompose J, damp from its smallest singular value
+        for (int i = 0; i < n; ++i)
+        {
+            jacobian[i] = jx[i];
+            jacobian[n + i] = jy[i];
+        }
+        double sigma[2];
+        double e[2] = { dx, dy };
+        svdDecompose(&jacobian[0], 2, n, &svdWork[0], sigma);
+        lambda = adaptiveDamping(n < 2 ? sigma[0] : min(sigma[0], sigma[1]));
+        svdSolve(2, n, &svdWork[0], sigma, e, lambda, &oldDelta[0]);
+        if (nullGain != 0)
+        {
+            // z - J+ J z, solving into the Jacobian copy, which svdDecompose() has finished with
+            double jz[2] = { 0, 0 };
+            for (int i = 0; i < n; ++i)
+            {
+                nullStep[i] = centring(i);
+                jz[0] += jx[i] * nullStep[i];
+                jz[1] += jy[i] * nullStep[i];
+            }
+            svdSolve(2, n, &svdWork[0], sigma, jz, lambda, &jacobian[0]);
+            for (int i = 0; i < n; ++i)
+                oldDelta[i] += nullStep[i] - jacobian[i];
+        }
+        applyDelta();
+        return true;
+    }
+
+    // Product J J^T is 2 x 2 whatever the length of the chain
+    double a = 0, b = 0, d = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        a += jx[i] * jx[i];
+        b += jx[i] * jy[i];
+        d += jy[i] * jy[i];
+    }
+
+    lambda = 0;
+    if (ikMethod == DAMPED_LEAST_SQUARES)
+    {
+        // Smallest eigenvalue of J J^T is the square of the smallest singular value of J
+        double half = (a + d) / 2;
+        double root = sqrt((a - d) * (a - d) / 4 + b * b);
+        lambda = adaptiveDamping(sqrt(max(half - root, 0.0)));
+        a += lambda * lambda;
+        d += lambda * lambda;
+    }
+
+    double det = a * d - b * b;
+    if (det == 0)
+    {
+        // Singularity: repeat the previous increments
+        applyDelta();
+        return false;
+    }
+
+    // Secondary motion z is projected as z - J^T (J J^T)^-1 J z, so J z is
+    // subtracted from the task step before the one 2 x 2 inverse is applied
+    double ex = dx, ey = dy;
+    if (nullGain != 0)
+        for (int i = 0; i < n; ++i)
+        {
+            nullStep[i] = centring(i);
+            ex -= jx[i] * nullStep[i];
+            ey -= jy[i] * nullStep[i];
+        }
+
+    // (J J^T)^-1 (ex, ey), then the increments are J^T times that plus z
+    double wx = ( d * ex - b * ey) / det;
+    double wy = (-b * ex + a * ey) / det;
+    for (int i = 0; i < n; ++i)
+        oldDelta[i] = jx[i] * wx + jy[i] * wy + (nullGain != 0 ? nullStep[i] : 0);
+    applyDelta();
+    return true;
+}
@@ -0,0 +1,166 @@
+// Inverse kinematics in three dimensions for a serial chain of hinge joints.
+
+#include "include/ikchain3d.h"
+#include "include/iklinalg.h"
+#include "include/iksimd.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace cugl;
+
+IKChain3D::IKChain3D(const Vector axes[], const Vector offsets[], int n)
+    : n(n), offsets(offsets, offsets + n), angles(n, 0), halfAngles(n, 0), sines(n, 0), cosines(n, 0),
+      position(n), worldAxes(n), jac(6 * n, 0), oldDelta(n, 0)
+{
+    for (int i = 0; i < n; ++i)
+        this->axes.push_back(axes[i].unit());
+    damping = 0.003 * reach();
+    setStepLimits(0.1 * reach(), 0.5);
+}
+
+double IKChain3D::reach() const
+{
+    double sum = 0;
+    for (int i = 0; i < n; ++i)
+        sum += offsets[i].length();
+    return sum;
+}
+
+void IKChain3D::setStepLimits(double step, double turn)
+{
+    maxStep = step;
+    maxTurn = turn;
+}
+
+void IKChain3D::forward()
+{
+    // Quaternion::apply() computes q^-1 w q, so joint i is the quaternion
+    // (cos(a_i/2), -sin(a_i/2) axis_i), and links 0 to i compose as q_i ... q_0
+    for (int i = 0; i < n; ++i)
+        halfAngles[i] = -angles[i] / 2;
+    sinCos(&halfAngles[0], &sines[0], &cosines[0], n);
+
+    // The world axis of joint i is unchanged by joint i's own rotation, so
+    // the composed rotation of links 0 to i can be applied to the local axis
+    Quaternion rotation;
+    Vector p;
+    for (int i = 0; i < n; ++i)
+    {
+        rotation = Quaternion(GLfloat(cosines[i]), GLfloat(sines[i]) * axes[i]) * rotation;
+        position[i] = p;
+        worldAxes[i] = rotation.apply(axes[i]);
+        p += rotation.apply(offsets[i]);
+    }
+    tipPosition = p;
+    tipRotation = rotation;
+
+    for (int i = 0; i < n; ++i)
+    {
+        const Vector & a = worldAxes[i];
+        Vector v = cross(a, p - position[i]);
+        for (int r = 0; r < 3; ++r)
+        {
+            jac[r * n + i] = v[r];
+            jac[(r + 3) * n + i] = a[r];
+        }
+    }
+}
+
+bool IKChain3D::step(const double e[], int m)
+{
+    // Lower triangle of J J^T + lambda^2 I for the first m rows of J
+    double a[36];
+    for (int r = 0; r < m; ++r)
+        for (int c = 0; c <= r; ++c)
+        {
+            double sum = r == c ? damping * damping : 0;
+            for (int i = 0; i < n; ++i)
+                sum += jac[r * n + i] * jac[c * n + i];
+            a[r * m + c] = sum;
+        }
+
+    double w[6];
+    if (!choleskyDecompose(a, m))
+    {
+        // Singularity: repeat the previous increments
+        for (int i = 0; i < n; ++i)
+            angles[i] += oldDelta[i];
+        return false;
+    }
+    choleskySolve(a, m, e, w);
+
+    for (int i = 0; i < n; ++i)
+    {
+        double delta = 0;
+        for (int r = 0; r < m; ++r)
+            delta += jac[r * n + i] * w[r];
+        oldDelta[i] = delta;
+        angles[i] += delta;
+    }
+    return true;
+}
+
+bool IKChain3D::solveStep(const Vector & dp, const Vector & dr)
+{
+    double e[6] = { dp[0], dp[1], dp[2], dr[0], dr[1], dr[2] };
+    return step(e, 6);
+}
+
+bool IKChain3D::solveStep(const Vector & dp)
+{
+    double e[3] = { dp[0], dp[1], dp[2] };
+    return step(e, 3);
+}
+
+// Scale v down to length at most limit
+static Vector clampLength(const Vector & v, double limit)
+{
+    double len = v.length();
+    return len > limit ? GLfloat(limit / len) * v : v;
+}
+
+int IKChain3D::solve(const Vector & target, const Quaternion & orientation,
+                     double tolerance, double angleTolerance, int maxIterations)
+{
+    int it = 0;
+    for (forward(); it < maxIterations; ++it, forward())
+    {
+        Vector dp = target - tipPosition;
+        Vector dr = rotationVector(tipRotation.conj() * orientation);
+        if (dp.length() < tolerance && dr.length() < angleTolerance)
+            break;
+        solveStep(clampLength(dp, maxStep), clampLength(dr, maxTurn));
+    }
+    return it;
+}
+
+int IKChain3D::solve(const Vector & target, double tolerance, int maxIterations)
+{
+    int it = 0;
+    for (forward(); it < maxIterations; ++it, forward())
+    {
+        Vector dp = target - tipPosition;
+        if (dp.length() < tolerance)
+            break;
+        solveStep(clampLength(dp, maxStep));
+    }
+    return it;
+}
+
+Vector rotationVector(const Quaternion & q)
+{
+    // q and -q are the same rotation; the one with s >= 0 turns through at
+    // most pi.  apply() turns through -2 acos(s) about v.
+    double s = q.scalar();
+    Vector v = q.vector();
+    if (s < 0)
+    {
+        s = -s;
+        v = -v;
+    }
+    double len = v.length();
+    if (len < 1e-12)
+        return GLfloat(-2) * v;
+    return GLfloat(-2 * atan2(len, s) / len) * v;
+}
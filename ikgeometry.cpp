@@ -0,0 +1,121 @@
+// Tessellated meshes built once and drawn at any size.
+
+#include "include/ikgeometry.h"
+
+#include <cmath>
+
+using namespace std;
+
+static const double PI = 4 * atan(1.0);
+
+const DetailLevel detailLevels[numDetailLevels] =
+{
+    { 6, 4, 0 },
+    { 10, 6, 4 },
+    { 16, 10, 12 },
+    { 20, 20, 40 }
+};
+
+int selectDetail(double pixels, int current, double hysteresis)
+{
+    int level = 0;
+    while (level + 1 < numDetailLevels && pixels >= detailLevels[level + 1].minPixels)
+        ++level;
+    if (current < 0 || current >= numDetailLevels)
+        return level;
+
+    // Go up only past the threshold plus the margin, and down only below it minus the margin
+    while (level > current && pixels < detailLevels[level].minPixels * (1 + hysteresis))
+        --level;
+    while (level < current && pixels >= detailLevels[level + 1].minPixels * (1 - hysteresis))
+        ++level;
+    return level;
+}
+
+double projectedRadius(double radius, double depth, double fovy, int height)
+{
+    if (depth <= 0)
+        return height;
+    return radius * height / (2 * tan(fovy * PI / 360) * depth);
+}
+
+GeometryCache::GeometryCache() : quadric(0)
+{}
+
+GeometryCache::~GeometryCache()
+{
+    for (map<Key, GLuint>::iterator it = lists.begin(); it != lists.end(); ++it)
+        glDeleteLists(it->second, 1);
+    if (quadric)
+        gluDeleteQuadric(quadric);
+}
+
+GLuint GeometryCache::mesh(GeometryShape shape, int slices, int stacks)
+{
+    Key key = { shape, slices, stacks };
+    map<Key, GLuint>::iterator it = lists.find(key);
+    if (it != lists.end())
+        return it->second;
+
+    // One quadric serves every mesh; it is only needed while compiling
+    if (!quadric)
+    {
+        quadric = gluNewQuadric();
+        gluQuadricDrawStyle(quadric, GLU_FILL);
+        gluQuadricOrientation(quadric, GLU_OUTSIDE);
+        gluQuadricNormals(quadric, GLU_SMOOTH);
+    }
+    GLuint list = glGenLists(1);
+    glNewList(list, GL_COMPILE);
+    if (shape == CYLINDER)
+        gluCylinder(quadric, 1, 1, 1, slices, stacks);
+    else
+        gluSphere(quadric, 1, slices, stacks);
+    glEndList();
+    lists[key] = list;
+    return list;
+}
+
+void GeometryCache::cylinder(double radius, double length, int slices, int stacks)
+{
+    GLuint list = mesh(CYLINDER, slices, stacks);
+    glPushMatrix();
+    glScaled(radius, radius, length);
+    glCallList(list);
+    glPopMatrix();
+}
+
+void GeometryCache::sphere(double radius, int slices, int stacks)
+{
+    GLuint list = mesh(SPHERE, slices, stacks);
+    glPushMatrix();
+    glScaled(radius, radius, radius);
+    glCallList(list);
+    glPopMatrix();
+}
+
+void GeometryCache::prepare()
+{
+    for (int level = 0; level < numDetailLevels; ++level)
+    {
+        mesh(CYLINDER, detailLevels[level].slices, 1);
+        mesh(SPHERE, detailLevels[level].slices, detailLevels[level].stacks);
+    }
+}
+
+void GeometryCache::cylinder(double radius, double length, int level)
+{
+    cylinder(radius, length, detailLevels[level].slices, 1);
+}
+
+void GeometryCache::sphere(double radius, int level)
+{
+    sphere(radius, detailLevels[level].slices, detailLevels[level].stacks);
+}
+
+int GeometryCache::triangles(GeometryShape shape, int level)
+{
+    // GLU draws a cylinder's stacks as quads and a sphere's poles as fans
+    const DetailLevel & d = detailLevels[level];
+    return shape == CYLINDER ? 2 * d.slices : 2 * d.slices * (d.stacks - 1);
+}
@@ -0,0 +1,102 @@
+// A flat hierarchy of links with world transforms computed in one pass.
+
+#include "include/ikhierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+int LinkHierarchy::add(int parent, double length, double angle)
+{
+    int i = size();
+    int p = parent < i ? parent : -1;
+    parents.push_back(p);
+    firstChild.push_back(-1);
+    lastChild.push_back(-1);
+    nextSibling.push_back(-1);
+    if (p >= 0)
+    {
+        if (lastChild[p] < 0)
+            firstChild[p] = i;
+        else
+            nextSibling[lastChild[p]] = i;
+        lastChild[p] = i;
+    }
+    lengths.push_back(length);
+    angles.push_back(angle);
+    worlds.resize(worlds.size() + 16, 0);
+    dirty.push_back(1);
+    pending.push_back(i);
+    return i;
+}
+
+void LinkHierarchy::place(int i)
+{
+    static const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+    // The parent's end frame is its base frame moved along its z axis;
+    // a turn about x keeps column 0 and rotates columns 1 and 2
+    int p = parents[i];
+    const double *w = p < 0 ? identity : &worlds[16 * p];
+    double l = p < 0 ? 0 : lengths[p];
+    double c = cos(angles[i]), s = sin(angles[i]);
+    double *m = &worlds[16 * i];
+    for (int r = 0; r < 3; ++r)
+    {
+        m[r] = w[r];
+        m[4 + r] = c * w[4 + r] + s * w[8 + r];
+        m[8 + r] = c * w[8 + r] - s * w[4 + r];
+        m[12 + r] = w[12 + r] + l * w[8 + r];
+    }
+    m[3] = m[7] = m[11] = 0;
+    m[15] = 1;
+}
+
+void LinkHierarchy::update()
+{
+    touched.clear();
+    if (pending.empty())
+        return;
+    sort(pending.begin(), pending.end());
+
+    const int n = size();
+    if (parents[pending[0]] < 0)
+    {
+        // A root moved: sweep forwards, recomputing a link if it turned or
+        // its parent was recomputed, and marking it so its children follow
+        for (int i = pending[0]; i < n; ++i)
+        {
+            int p = parents[i];
+            if (!dirty[i] && (p < 0 || !dirty[p]))
+                continue;
+            dirty[i] = 1;
+            touched.push_back(i);
+            place(i);
+        }
+    }
+    else
+    {
+        // Walk the subtree below each dirty link, skipping those already
+        // reached from a dirty ancestor, which has a lower index
+        for (size_t k = 0; k < pending.size(); ++k)
+        {
+            if (dirty[pending[k]] != 1)
+                continue;
+            stack.push_back(pending[k]);
+            while (!stack.empty())
+            {
+                int i = stack.back();
+                stack.pop_back();
+                dirty[i] = 2;
+                touched.push_back(i);
+                place(i);
+                for (int c = firstChild[i]; c >= 0; c = nextSibling[c])
+                    stack.push_back(c);
+            }
+        }
+    }
+    for (size_t k = 0; k < touched.size(); ++k)
+        dirty[touched[k]] = 0;
+    pending.clear();
+}
@@ -0,0 +1,305 @@
+// Draw crowds of links with OpenGL 3.3 core-profile instancing.
+
+// GLEW must be included before any other GL header
+#include <GL/glew.h>
+#include "include/ikinstanced.h"
+
+#include <cmath>
+
+using namespace std;
+
+static const double PI = 4 * atan(1.0);
+
+namespace
+{
+    const char *vertexShader =
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 position;\n"
+        "layout(location = 1) in vec3 normal;\n"
+        "layout(location = 2) in mat4 world;\n"
+        "layout(location = 6) in vec3 scale;\n"
+        "layout(location = 7) in vec4 colour;\n"
+        "uniform mat4 projection;\n"
+        "uniform mat4 view;\n"
+        "out vec3 eyeNormal;\n"
+        "out vec4 material;\n"
+        "void main()\n"
+        "{\n"
+        "    mat4 modelView = view * world;\n"
+        "    eyeNormal = mat3(modelView) * (normal / scale);\n"
+        "    material = colour;\n"
+        "    gl_Position = projection * modelView * vec4(position * scale, 1.0);\n"
+        "}\n";
+
+    // Global ambient 0.2, white diffuse and specular light, viewer along +z
+    const char *fragmentShader =
+        "#version 330 core\n"
+        "in vec3 eyeNormal;\n"
+        "in vec4 material;\n"
+        "uniform vec3 light;\n"
+        "out vec4 fragment;\n"
+        "void main()\n"
+        "{\n"
+        "    vec3 n = normalize(eyeNormal);\n"
+        "    float diffuse = max(dot(n, light), 0.0);\n"
+        "    float specular = diffuse > 0.0 ? pow(max(dot(n, normalize(light + vec3(0.0, 0.0, 1.0))), 0.0), 50.0) : 0.0;\n"
+        "    fragment = vec4((0.2 + diffuse) * material.rgb + vec3(specular), material.a);\n"
+        "}\n";
+
+    // Compile a shader, appending its log to failure if it does not compile
+    GLuint compile(GLenum type, const char *source, string & failure)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, 0);
+        glCompileShader(shader);
+        GLint ok;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (!ok)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), 0, log);
+            failure += log;
+        }
+        return shader;
+    }
+
+    // Append the unit mesh of shape at level to the vertices (position and
+    // normal) and indices, with the same triangles as GLU draws.  Rows run
+    // from the top down for both shapes, so both wind counterclockwise
+    // seen from outside.
+    void tessellate(GeometryShape shape, int level, vector<float> & vertices, vector<GLuint> & indices)
+    {
+        int slices = detailLevels[level].slices;
+        int stacks = shape == CYLINDER ? 1 : detailLevels[level].stacks;
+        GLuint base = GLuint(vertices.size() / 6);
+        for (int j = 0; j <= stacks; ++j)
+        {
+            double polar = PI * j / stacks;
+            for (int i = 0; i <= slices; ++i)
+            {
+                double azimuth = 2 * PI * i / slices;
+                double nx, ny, nz, z;
+                if (shape == CYLINDER)
+                {
+                    nx = cos(azimuth);
+                    ny = sin(azimuth);
+                    nz = 0;
+                    z = 1 - double(j) / stacks;
+                }
+                else
+                {
+                    nx = sin(polar) * cos(azimuth);
+                    ny = sin(polar) * sin(azimuth);
+                    nz = cos(polar);
+                    z = nz;
+                }
+                float v[6] = { float(nx), float(ny), float(z), float(nx), float(ny), float(nz) };
+                vertices.insert(vertices.end(), v, v + 6);
+            }
+        }
+        for (int j = 0; j < stacks; ++j)
+            for (int i = 0; i < slices; ++i)
+            {
+                GLuint a = base + j * (slices + 1) + i, b = a + 1, c = a + slices + 1, d = c + 1;
+                // A sphere's first and last stacks are fans about the poles
+                if (shape == CYLINDER || j > 0)
+                {
+                    GLuint t[3] = { a, c, b };
+                    indices.insert(indices.end(), t, t + 3);
+                }
+                if (shape == CYLINDER || j < stacks - 1)
+                {
+                    GLuint t[3] = { b, c, d };
+                    indices.insert(indices.end(), t, t + 3);
+                }
+            }
+    }
+}
+
+InstancedRenderer::InstancedRenderer() : program(0), calls(0), drawn(0)
+{
+    for (int s = 0; s < 2; ++s)
+        meshes[s].vertexArray = meshes[s].vertices = meshes[s].indices = meshes[s].instances = 0;
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+    if (!program)
+        return;
+    for (int s = 0; s < 2; ++s)
+    {
+        glDeleteVertexArrays(1, &meshes[s].vertexArray);
+        GLuint buffers[3] = { meshes[s].vertices, meshes[s].indices, meshes[s].instances };
+        glDeleteBuffers(3, buffers);
+    }
+    glDeleteProgram(program);
+}
+
+bool InstancedRenderer::initialize()
+{
+    // Core profiles need GLEW's experimental mode to load every entry
+    // point.  A context without a GLX display (EGL, for instance) leaves
+    // only the GLX extensions unloaded, which the renderer does not use.
+    glewExperimental = GL_TRUE;
+    GLenum status = glewInit();
+    glGetError();       // A core profile rejects GLEW's glGetString(GL_EXTENSIONS)
+    if (status != GLEW_OK && status != GLEW_ERROR_NO_GLX_DISPLAY)
+    {
+        failure = reinterpret_cast<const char *>(glewGetErrorString(status));
+        return false;
+    }
+    if (!GLEW_VERSION_3_3)
+    {
+        failure = "OpenGL 3.3 is not available";
+        return false;
+    }
+
+    GLuint vertex = compile(GL_VERTEX_SHADER, vertexShader, failure);
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentShader, failure);
+    program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint ok;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), 0, log);
+        failure += log;
+    }
+    if (!failure.empty())
+    {
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+    projectionLocation = glGetUniformLocation(program, "projection");
+    viewLocation = glGetUniformLocation(program, "view");
+    lightLocation = glGetUniformLocation(program, "light");
+
+    build(meshes[CYLINDER], CYLINDER);
+    build(meshes[SPHERE], SPHERE);
+    return true;
+}
+
+void InstancedRenderer::build(Mesh & mesh, GeometryShape shape)
+{
+    vector<float> vertices;
+    vector<GLuint> indices;
+    for (int level = 0; level < numDetailLevels; ++level)
+    {
+        mesh.first[level] = int(indices.size());
+        tessellate(shape, level, vertices, indices);
+        mesh.count[level] = int(indices.size()) - mesh.first[level];
+    }
+
+    glGenVertexArrays(1, &mesh.vertexArray);
+    glBindVertexArray(mesh.vertexArray);
+    glGenBuffers(1, &mesh.vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertices);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), reinterpret_cast<void *>(3 * sizeof(float)));
+    glGenBuffers(1, &mesh.indices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indices);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+
+    // Per instance: the world matrix's four columns, the scale and the colour
+    glGenBuffers(1, &mesh.instances);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.instances);
+    const GLsizei stride = floatsPerInstance * sizeof(float);
+    for (int k = 0; k < 6; ++k)
+    {
+        glEnableVertexAttribArray(2 + k);
+        glVertexAttribPointer(2 + k, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(4 * k * sizeof(float)));
+        glVertexAttribDivisor(2 + k, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void InstancedRenderer::clear()
+{
+    cylinders.clear();
+    spheres.clear();
+}
+
+void InstancedRenderer::add(GeometryShape shape, const double *world, double sx, double sy, double sz, const float *colour)
+{
+    vector<float> & data = shape == CYLINDER ? cylinders : spheres;
+    for (int k = 0; k < 16; ++k)
+        data.push_back(float(world[k]));
+    float rest[8] = { float(sx), float(sy), float(sz), 1, colour[0], colour[1], colour[2], colour[3] };
+    data.insert(data.end(), rest, rest + 8);
+}
+
+void InstancedRenderer::draw(const float *projection, const float *view, const float *light, int level)
+{
+    calls = 0;
+    drawn = 0;
+    if (!program)
+        return;
+    glUseProgram(program);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection);
+    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, view);
+    glUniform3fv(lightLocation, 1, light);
+    drawMesh(meshes[CYLINDER], cylinders, CYLINDER, level);
+    drawMesh(meshes[SPHERE], spheres, SPHERE, level);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void InstancedRenderer::drawMesh(Mesh & mesh, const vector<float> & data, GeometryShape shape, int level)
+{
+    GLsizei count = GLsizei(data.size() / floatsPerInstance);
+    if (count == 0)
+        return;
+    glBindVertexArray(mesh.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.instances);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STREAM_DRAW);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh.count[level], GL_UNSIGNED_INT,
+                            reinterpret_cast<void *>(mesh.first[level] * sizeof(GLuint)), count);
+    ++calls;
+    drawn += long(count) * GeometryCache::triangles(shape, level);
+}
+
+void perspectiveMatrix(float *m, double fovy, double aspect, double zNear, double zFar)
+{
+    double f = 1 / tan(fovy * PI / 360);
+    for (int k = 0; k < 16; ++k)
+        m[k] = 0;
+    m[0] = float(f / aspect);
+    m[5] = float(f);
+    m[10] = float((zFar + zNear) / (zNear - zFar));
+    m[11] = -1;
+    m[14] = float(2 * zFar * zNear / (zNear - zFar));
+}
+
+void lookAtMatrix(float *m, const double *eye, const double *centre, const double *up)
+{
+    // Forward f, side s = f x up and true up u = s x f, as rows of the rotation
+    double f[3] = { centre[0] - eye[0], centre[1] - eye[1], centre[2] - eye[2] };
+    double length = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (int r = 0; r < 3; ++r)
+        f[r] /= length;
+    double s[3] = { f[1] * up[2] - f[2] * up[1], f[2] * up[0] - f[0] * up[2], f[0] * up[1] - f[1] * up[0] };
+    length = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    for (int r = 0; r < 3; ++r)
+        s[r] /= length;
+    double u[3] = { s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0] };
+    for (int c = 0; c < 3; ++c)
+    {
+        m[4 * c] = float(s[c]);
+        m[4 * c + 1] = float(u[c]);
+        m[4 * c + 2] = float(-f[c]);
+        m[4 * c + 3] = 0;
+    }
+    m[12] = float(-(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]));
+    m[13] = float(-(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]));
+    m[14] = float(f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2]);
+    m[15] = 1;
+}
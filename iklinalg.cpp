@@ -0,0 +1,172 @@
+// Small dense linear algebra used by the IK solvers.
+
+#include "include/iklinalg.h"
+
+#include <cmath>
+
+using namespace std;
+
+int svdWorkSize(int m, int n)
+{
+    int p = m < n ? m : n;
+    int q = m < n ? n : m;
+    return q * p + p * p;
+}
+
+void svdDecompose(const double a[], int m, int n, double work[], double sigma[])
+{
+    // Rotate the p columns of B, each of length q, until they are mutually
+    // orthogonal.  B is a^T when a is wide and a itself when a is tall, so
+    // the rotations always act on the smaller dimension.  W accumulates them.
+    const bool wide = m <= n;
+    const int p = wide ? m : n;
+    const int q = wide ? n : m;
+    double *b = work;
+    double *w = work + q * p;
+
+    for (int k = 0; k < p; ++k)
+        for (int i = 0; i < q; ++i)
+            b[k * q + i] = wide ? a[k * n + i] : a[i * n + k];
+    for (int k = 0; k < p * p; ++k)
+        w[k] = 0;
+    for (int k = 0; k < p; ++k)
+        w[k * p + k] = 1;
+
+    const double eps = 1e-15;
+    for (int sweep = 0; sweep < 30; ++sweep)
+    {
+        bool rotated = false;
+        for (int i = 0; i < p - 1; ++i)
+            for (int k = i + 1; k < p; ++k)
+            {
+                double *bi = b + i * q, *bk = b + k * q;
+                double alpha = 0, beta = 0, gamma = 0;
+                for (int r = 0; r < q; ++r)
+                {
+                    alpha += bi[r] * bi[r];
+                    beta += bk[r] * bk[r];
+                    gamma += bi[r] * bk[r];
+                }
+                if (gamma == 0 || fabs(gamma) <= eps * sqrt(alpha * beta))
+                    continue;
+                rotated = true;
+                double zeta = (beta - alpha) / (2 * gamma);
+                double t = (zeta >= 0 ? 1 : -1) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+                double c = 1 / sqrt(1 + t * t);
+                double s = c * t;
+                for (int r = 0; r < q; ++r)
+                {
+                    double u = bi[r], v = bk[r];
+                    bi[r] = c * u - s * v;
+                    bk[r] = s * u + c * v;
+                }
+                double *wi = w + i * p, *wk = w + k * p;
+                for (int r = 0; r < p; ++r)
+                {
+                    double u = wi[r], v = wk[r];
+                    wi[r] = c * u - s * v;
+                    wk[r] = s * u + c * v;
+                }
+            }
+        if (!rotated)
+            break;
+    }
+
+    for (int k = 0; k < p; ++k)
+    {
+        double norm2 = 0;
+        for (int r = 0; r < q; ++r)
+            norm2 += b[k * q + r] * b[k * q + r];
+        sigma[k] = sqrt(norm2);
+    }
+}
+
+int svdSolve(int m, int n, const double work[], const double sigma[],
+             const double e[], double lambda, double x[])
+{
+    // Column k of B has length s_k.  For a wide matrix a = W S U^T with
+    // u_k = b_k / s_k; for a tall one a = U S W^T.
+    const bool wide = m <= n;
+    const int p = wide ? m : n;
+    const int q = wide ? n : m;
+    const double *b = work;
+    const double *w = work + q * p;
+
+    double largest = 0;
+    for (int k = 0; k < p; ++k)
+        if (sigma[k] > largest)
+            largest = sigma[k];
+
+    for (int i = 0; i < n; ++i)
+        x[i] = 0;
+    const double lambda2 = lambda * lambda;
+    int rank = 0;
+    for (int k = 0; k < p; ++k)
+    {
+        if (sigma[k] <= largest * 1e-10)
+            continue;
+        ++rank;
+        const double *bk = b + k * q, *wk = w + k * p;
+        double denominator = sigma[k] * sigma[k] + lambda2;
+        if (wide)
+        {
+            double we = 0;
+            for (int r = 0; r < m; ++r)
+                we += wk[r] * e[r];
+            double f = we / denominator;
+            for (int i = 0; i < n; ++i)
+                x[i] += f * bk[i];
+        }
+        else
+        {
+            double be = 0;
+            for (int r = 0; r < m; ++r)
+                be += bk[r] * e[r];
+            double f = be / denominator;
+            for (int i = 0; i < n; ++i)
+                x[i] += f * wk[i];
+        }
+    }
+    return rank;
+}
+
+bool choleskyDecompose(double a[], int n)
+{
+    for (int j = 0; j < n; ++j)
+    {
+        double d = a[j * n + j];
+        for (int k = 0; k < j; ++k)
+            d -= a[j * n + k] * a[j * n + k];
+        if (!(d > 0))
+            return false;
+        d = sqrt(d);
+        a[j * n + j] = d;
+        for (int i = j + 1; i < n; ++i)
+        {
+            double s = a[i * n + j];
+            for (int k = 0; k < j; ++k)
+                s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / d;
+        }
+    }
+    return true;
+}
+
+void choleskySolve(const double l[], int n, const double b[], double x[])
+{
+    // Forward substitution with L, then back substitution with L^T
+    for (int i = 0; i < n; ++i)
+    {
+        double s = b[i];
+        for (int k = 0; k < i; ++k)
+            s -= l[i * n + k] * x[k];
+        x[i] = s / l[i * n + i];
+    }
+    for (int i = n - 1; i >= 0; --i)
+    {
+        double s = x[i];
+        for (int k = i + 1; k < n; ++k)
+            s -= l[k * n + i] * x[k];
+        x[i] = s / l[i * n + i];
+    }
+}
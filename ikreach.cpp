@@ -0,0 +1,181 @@
+// A precomputed map of where a chain's tip can go, for screening targets.
+
+#include "include/ikreach.h"
+#include "include/ikrandom.h"
+#include "include/iktask.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const double PI = 4 * atan(1.0);
+
+// Samples are drawn in this many blocks with their own seeds, so the set of
+// samples does not depend on how the blocks are shared among the workers
+static const int sampleBlocks = 256;
+
+ReachabilityMap::ReachabilityMap() : res(0), extent(0)
+{}
+
+namespace
+{
+    // What one worker has seen: tip directions per cell, and the sampled
+    // tip nearest each cell's centre with its squared distance
+    struct Tally
+    {
+        vector<unsigned short> directions;
+        vector<float> points;
+        vector<double> distance;
+    };
+}
+
+void ReachabilityMap::build(const IKChain & chain, int resolution, long samples, TaskPool & pool)
+{
+    res = max(resolution, 1);
+    extent = chain.reach();
+    int cells = res * res;
+    double size = 2 * extent / res;
+
+    // Joints without a limit on one side range over a full turn
+    int n = chain.size();
+    vector<double> lo(n), span(n);
+    for (int i = 0; i < n; ++i)
+    {
+        lo[i] = max(chain.lowerLimit(i), -PI);
+        span[i] = min(chain.upperLimit(i), PI) - lo[i];
+    }
+
+    // Worker slot s runs blocks s, s + slots, ...; the tallies are merged
+    // afterwards with operations that do not depend on the order
+    int slots = pool.threads();
+    vector<Tally> tallies(slots);
+    pool.parallelFor(slots, [&](int s)
+    {
+        Tally & t = tallies[s];
+        t.directions.assign(cells, 0);
+        t.points.assign(2 * cells, 0);
+        t.distance.assign(cells, HUGE_VAL);
+        IKChain arm(chain);
+        for (int b = s; b < sampleBlocks; b += slots)
+        {
+            IKRandom rng(2654435761u * unsigned(b + 1));
+            long count = samples / sampleBlocks + (b < samples % sampleBlocks ? 1 : 0);
+            for (long k = 0; k < count; ++k)
+            {
+                for (int i = 0; i < n; ++i)
+                    arm.setAngle(i, lo[i] + span[i] * rng.real());
+                arm.forward();
+                double x = arm.tipX(), y = arm.tipY();
+                int c = cell(x, y);
+                double direction = arm.linkAngle(n - 1) / (2 * PI);
+                t.directions[c] |= 1 << (int(16 * (direction - floor(direction))) & 15);
+
+                double cx = -extent + size * (c % res + 0.5), cy = -extent + size * (c / res + 0.5);
+                double d = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+                if (d < t.distance[c])
+                {
+                    t.distance[c] = d;
+                    t.points[2 * c] = float(x);
+                    t.points[2 * c + 1] = float(y);
+                }
+            }
+        }
+    });
+
+    directions.assign(cells, 0);
+    points.assign(2 * cells, 0);
+    vector<double> distance(cells, HUGE_VAL);
+    for (int s = 0; s < slots; ++s)
+        for (int c = 0; c < cells; ++c)
+        {
+            const Tally & t = tallies[s];
+            directions[c] |= t.directions[c];
+            bool closer = t.distance[c] < distance[c] ||
+                (t.distance[c] == distance[c] && t.distance[c] < HUGE_VAL &&
+                 (t.points[2 * c] < points[2 * c] ||
+                  (t.points[2 * c] == points[2 * c] && t.points[2 * c + 1] < points[2 * c + 1])));
+            if (closer)
+            {
+                distance[c] = t.distance[c];
+                points[2 * c] = t.points[2 * c];
+                points[2 * c + 1] = t.points[2 * c + 1];
+            }
+        }
+
+    // Nearest reachable cell by propagating each neighbour's nearest cell
+    // in a forward and a backward sweep; this is exact for almost every
+    // cell and within a cell of the nearest for the rest
+    nearest.assign(cells, -1);
+    for (int c = 0; c < cells; ++c)
+        if (directions[c])
+            nearest[c] = c;
+    const int forwardRows[4] = { 0, -1, -1, -1 }, forwardCols[4] = { -1, -1, 0, 1 };
+    for (int sweep = 0; sweep < 2; ++sweep)
+    {
+        int sign = sweep ? -1 : 1;
+        for (int k = 0; k < cells; ++k)
+        {
+            int c = sweep ? cells - 1 - k : k;
+            int row = c / res, col = c % res;
+            for (int m = 0; m < 4; ++m)
+            {
+                int r = row + sign * forwardRows[m], q = col + sign * forwardCols[m];
+                if (r < 0 || r >= res || q < 0 || q >= res || nearest[r * res + q] < 0)
+                    continue;
+                int candidate = nearest[r * res + q];
+                int dr = candidate / res - row, dq = candidate % res - col;
+                int best = nearest[c];
+                int br = best / res - row, bq = best % res - col;
+                if (best < 0 || dr * dr + dq * dq < br * br + bq * bq)
+                    nearest[c] = candidate;
+            }
+        }
+    }
+}
+
+int ReachabilityMap::cell(double x, double y) const
+{
+    int col = int(floor((x + extent) / (2 * extent) * res));
+    int row = int(floor((y + extent) / (2 * extent) * res));
+    return min(max(row, 0), res - 1) * res + min(max(col, 0), res - 1);
+}
+
+double ReachabilityMap::coverage() const
+{
+    if (res == 0)
+        return 1;
+    return double(directions.size() - count(directions.begin(), directions.end(), 0)) / directions.size();
+}
+
+bool ReachabilityMap::reachable(double x, double y) const
+{
+    return res == 0 || (x * x + y * y <= extent * extent && directions[cell(x, y)] != 0);
+}
+
+double ReachabilityMap::dexterity(double x, double y) const
+{
+    if (res == 0)
+        return 1;
+    if (x * x + y * y > extent * extent)
+        return 0;
+    unsigned bits = directions[cell(x, y)];
+    int seen = 0;
+    for (; bits; bits &= bits - 1)
+        ++seen;
+    return seen / 16.0;
+}
+
+bool ReachabilityMap::clamp(double & x, double & y) const
+{
+    if (reachable(x, y))
+        return false;
+    int c = cell(x, y);
+    if (!directions[c])
+        c = nearest[c];
+    if (c < 0)
+        return false;
+    x = points[2 * c];
+    y = points[2 * c + 1];
+    return true;
+}
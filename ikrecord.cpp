@@ -0,0 +1,210 @@
+// Compact binary recordings of IK sessions, for replaying them exactly.
+
+#include "include/ikrecord.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static const char magic[8] = { 'I', 'K', 'R', 'E', 'C', '1', 0, 0 };
+
+// Signed integers are stored as unsigned ones, small magnitudes first
+static unsigned long long zigzag(long long v)
+{
+    return (static_cast<unsigned long long>(v) << 1) ^ static_cast<unsigned long long>(v >> 63);
+}
+
+static long long unzigzag(unsigned long long v)
+{
+    return static_cast<long long>(v >> 1) ^ -static_cast<long long>(v & 1);
+}
+
+SessionRecorder::SessionRecorder(const string & path, const IKChain & chain, unsigned int seed, double quantum)
+    : out(path.c_str(), ios::binary), quantum(quantum), previous(chain.size(), 0), written(0)
+{
+    int n = chain.size();
+    double nullGain = chain.nullSpaceGain();
+    put(magic, sizeof(magic));
+    put(&n, sizeof(n));
+    put(&seed, sizeof(seed));
+    put(&quantum, sizeof(quantum));
+    for (int i = 0; i < n; ++i)
+    {
+        double l = chain.length(i), lo = chain.lowerLimit(i), hi = chain.upperLimit(i);
+        put(&l, sizeof(l));
+        put(&lo, sizeof(lo));
+        put(&hi, sizeof(hi));
+    }
+    put(&nullGain, sizeof(nullGain));
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    flush();
+}
+
+void SessionRecorder::solver(const string & solver, const IKChain & chain)
+{
+    unsigned char method = static_cast<unsigned char>(chain.method());
+    unsigned char size = static_cast<unsigned char>(min(solver.size(), size_t(255)));
+    put("M", 1);
+    put(&method, 1);
+    put(&size, 1);
+    put(solver.data(), size);
+}
+
+void SessionRecorder::target(double x, double y, const IKChain & chain)
+{
+    put("T", 1);
+    put(&x, sizeof(x));
+    put(&y, sizeof(y));
+    for (int i = 0; i < chain.size(); ++i)
+    {
+        double a = chain.angle(i);
+        put(&a, sizeof(a));
+        previous[i] = llround(a / quantum);
+    }
+}
+
+void SessionRecorder::step(const IKChain & chain, long nanoseconds)
+{
+    put("S", 1);
+    putVarint(static_cast<unsigned long long>(max(nanoseconds, 0L)));
+    for (int i = 0; i < chain.size(); ++i)
+    {
+        long long q = llround(chain.angle(i) / quantum);
+        putVarint(zigzag(q - previous[i]));
+        previous[i] = q;
+    }
+    if (buffer.size() >= 1 << 16)
+        flush();
+}
+
+void SessionRecorder::flush()
+{
+    if (!buffer.empty())
+        out.write(reinterpret_cast<const char *>(&buffer[0]), buffer.size());
+    out.flush();
+    written += long(buffer.size());
+    buffer.clear();
+}
+
+void SessionRecorder::put(const void *data, size_t size)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    buffer.insert(buffer.end(), p, p + size);
+}
+
+void SessionRecorder::putVarint(unsigned long long v)
+{
+    // Seven bits per byte, low bits first; the top bit marks a continuation
+    while (v >= 0x80)
+    {
+        buffer.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(v));
+}
+
+SessionReader::SessionReader(const string & path) : in(path.c_str(), ios::binary), ok(false), broken(false)
+{
+    char check[sizeof(magic)];
+    int n;
+    if (!in.read(check, sizeof(check)) || memcmp(check, magic, sizeof(magic)) != 0 ||
+        !in.read(reinterpret_cast<char *>(&n), sizeof(n)) || n < 1 || n > 1 << 20 ||
+        !in.read(reinterpret_cast<char *>(&head.seed), sizeof(head.seed)) ||
+        !in.read(reinterpret_cast<char *>(&head.quantum), sizeof(head.quantum)) || !(head.quantum > 0))
+        return;
+    head.lengths.resize(n);
+    head.lower.resize(n);
+    head.upper.resize(n);
+    for (int i = 0; i < n; ++i)
+        if (!in.read(reinterpret_cast<char *>(&head.lengths[i]), sizeof(double)) ||
+            !in.read(reinterpret_cast<char *>(&head.lower[i]), sizeof(double)) ||
+            !in.read(reinterpret_cast<char *>(&head.upper[i]), sizeof(double)))
+            return;
+    if (!in.read(reinterpret_cast<char *>(&head.nullGain), sizeof(head.nullGain)))
+        return;
+    previous.assign(n, 0);
+    ok = true;
+}
+
+long long SessionReader::quantise(double angle) const
+{
+    return llround(angle / head.quantum);
+}
+
+bool SessionReader::next(SessionEvent & e)
+{
+    if (!ok || broken)
+        return false;
+    char type;
+    if (!in.get(type))
+        return false;
+
+    int n = int(previous.size());
+    e.type = type;
+    if (type == 'M')
+    {
+        unsigned char method, size;
+        char name[256];
+        if (in.read(reinterpret_cast<char *>(&method), 1) && method <= SVD &&
+            in.read(reinterpret_cast<char *>(&size), 1) && in.read(name, size))
+        {
+            e.method = method;
+            e.solver.assign(name, size);
+            return true;
+        }
+    }
+    else if (type == 'T')
+    {
+        e.angles.resize(n);
+        bool read = in.read(reinterpret_cast<char *>(&e.x), sizeof(e.x)) &&
+                    in.read(reinterpret_cast<char *>(&e.y), sizeof(e.y)) &&
+                    in.read(reinterpret_cast<char *>(&e.angles[0]), n * sizeof(double));
+        if (read)
+        {
+            for (int i = 0; i < n; ++i)
+                previous[i] = quantise(e.angles[i]);
+            return true;
+        }
+    }
+    else if (type == 'S')
+    {
+        unsigned long long v;
+        if (getVarint(v))
+        {
+            e.nanoseconds = long(v);
+            e.quantised.resize(n);
+            e.angles.resize(n);
+            int i = 0;
+            for (; i < n && getVarint(v); ++i)
+            {
+                previous[i] += unzigzag(v);
+                e.quantised[i] = previous[i];
+                e.angles[i] = previous[i] * head.quantum;
+            }
+            if (i == n)
+                return true;
+        }
+    }
+    broken = true;
+    return false;
+}
+
+bool SessionReader::getVarint(unsigned long long & v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        char c;
+        if (!in.get(c))
+            return false;
+        v |= static_cast<unsigned long long>(static_cast<unsigned char>(c) & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
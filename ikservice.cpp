@@ -0,0 +1,358 @@
+// A local IK solve service on a Unix domain socket, and its client.
+
+#include "include/ikservice.h"
+#include "include/iksolver.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const size_t requestSize = 2 * sizeof(int) + 2 * sizeof(double);
+
+// A connection is not read from while it has this much unread input or unsent output
+static const size_t backlog = 1 << 18;
+
+#ifdef MSG_NOSIGNAL
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+struct IKService::Connection
+{
+    Connection(int fd, const IKChain & prototype, IKSolver *solver)
+        : fd(fd), chain(prototype), solver(solver), sent(0), finished(false), failed(false)
+    {}
+
+    int fd;
+    IKChain chain;
+    unique_ptr<IKSolver> solver;
+    vector<char> input;
+    vector<char> output;
+    size_t sent;            // bytes of output already written
+    bool finished;          // the client will send nothing more
+    bool failed;
+};
+
+IKService::IKService(const IKChain & prototype, const string & solver, const ServiceOptions & options)
+    : prototype(prototype), solverName(solver), options(options), pool(options.threads), server(-1),
+      stopping(false), answered(0), rounds(0), largest(0)
+{}
+
+void IKService::solve(Connection & c)
+{
+    int n = c.chain.size();
+    size_t count = c.input.size() / requestSize;
+    size_t at = c.output.size();
+    c.output.resize(at + count * (2 * sizeof(int) + (n + 1) * sizeof(double)));
+    for (size_t k = 0; k < count; ++k)
+    {
+        const char *request = &c.input[k * requestSize];
+        int id;
+        double target[2];
+        memcpy(&id, request, sizeof(id));
+        memcpy(target, request + 2 * sizeof(int), sizeof(target));
+
+        int it = c.solver->solve(c.chain, target[0], target[1], options.tolerance, options.maxIterations);
+        double error = hypot(target[0] - c.chain.tipX(), target[1] - c.chain.tipY());
+
+        int head[2] = { id, it };
+        memcpy(&c.output[at], head, sizeof(head));
+        at += sizeof(head);
+        memcpy(&c.output[at], &error, sizeof(error));
+        at += sizeof(error);
+        memcpy(&c.output[at], c.chain.jointAngles(), n * sizeof(double));
+        at += n * sizeof(double);
+    }
+    c.input.erase(c.input.begin(), c.input.begin() + count * requestSize);
+    answered += long(count);
+}
+
+IKClient::IKClient() : fd(-1), n(0)
+{}
+
+IKClient::~IKClient()
+{
+    close();
+}
+
+#ifndef _WIN32
+
+IKService::~IKService()
+{
+    for (size_t k = 0; k < connections.size(); ++k)
+        ::close(connections[k]->fd);
+    if (server >= 0)
+    {
+        ::close(server);
+        unlink(path.c_str());
+    }
+}
+
+bool IKService::listen(const string & socketPath)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (socketPath.size() >= sizeof(address.sun_path))
+        return false;
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath.c_str());
+
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0)
+        return false;
+    unlink(socketPath.c_str());
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(server, 64) < 0)
+    {
+        ::close(server);
+        server = -1;
+        return false;
+    }
+    fcntl(server, F_SETFL, fcntl(server, F_GETFL) | O_NONBLOCK);
+    path = socketPath;
+    return true;
+}
+
+void IKService::run()
+{
+    vector<pollfd> polled;
+    vector<Connection *> work;
+    while (!stopping && server >= 0)
+    {
+        polled.clear();
+        pollfd listener = { server, POLLIN, 0 };
+        polled.push_back(listener);
+        for (size_t k = 0; k < connections.size(); ++k)
+        {
+            const Connection & c = *connections[k];
+            bool room = !c.finished && c.input.size() < backlog && c.output.size() - c.sent < backlog;
+            pollfd p = { c.fd, short((room ? POLLIN : 0) | (c.sent < c.output.size() ? POLLOUT : 0)), 0 };
+            polled.push_back(p);
+        }
+        if (poll(&polled[0], polled.size(), 100) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        // Read everything that has arrived, then solve it all as one batch
+        size_t existing = connections.size();
+        if (polled[0].revents & POLLIN)
+            accept();
+        work.clear();
+        long batch = 0;
+        for (size_t k = 0; k < existing; ++k)
+        {
+            Connection & c = *connections[k];
+            if (polled[k + 1].revents & (POLLIN | POLLHUP | POLLERR))
+                receive(c);
+            if (c.input.size() >= requestSize)
+            {
+                work.push_back(&c);
+                batch += long(c.input.size() / requestSize);
+            }
+        }
+        if (!work.empty())
+        {
+            pool.parallelFor(int(work.size()), [&](int k) { solve(*work[k]); });
+            ++rounds;
+            largest = max(largest.load(), batch);
+        }
+
+        for (size_t k = 0; k < connections.size(); ++k)
+        {
+            Connection & c = *connections[k];
+            send(c);
+            if (c.failed || (c.finished && c.sent == c.output.size()))
+            {
+                ::close(c.fd);
+                connections.erase(connections.begin() + k--);
+            }
+        }
+    }
+}
+
+void IKService::accept()
+{
+    for (;;)
+    {
+        int fd = ::accept(server, 0, 0);
+        if (fd < 0)
+            return;
+        IKSolver *solver = newSolver(solverName);
+        if (!solver)
+        {
+            ::close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        Connection *c = new Connection(fd, prototype, solver);
+        int links = prototype.size();
+        c->output.resize(sizeof(links));
+        memcpy(&c->output[0], &links, sizeof(links));
+        connections.push_back(unique_ptr<Connection>(c));
+    }
+}
+
+bool IKService::receive(Connection & c)
+{
+    char buffer[1 << 16];
+    while (c.input.size() < backlog)
+    {
+        ssize_t got = read(c.fd, buffer, sizeof(buffer));
+        if (got > 0)
+            c.input.insert(c.input.end(), buffer, buffer + got);
+        else if (got == 0)
+        {
+            c.finished = true;
+            return false;
+        }
+        else if (errno == EINTR)
+            continue;
+        else
+        {
+            c.failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return !c.failed;
+        }
+    }
+    return true;
+}
+
+void IKService::send(Connection & c)
+{
+    while (c.sent < c.output.size())
+    {
+        ssize_t put = ::send(c.fd, &c.output[c.sent], c.output.size() - c.sent, sendFlags);
+        if (put > 0)
+            c.sent += size_t(put);
+        else if (put < 0 && errno == EINTR)
+            continue;
+        else
+        {
+            c.failed = put == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            return;
+        }
+    }
+    c.output.clear();
+    c.sent = 0;
+}
+
+bool IKClient::connect(const string & path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    close();
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || !readFully(&n, sizeof(n)) || n < 1)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool IKClient::request(int id, double x, double y)
+{
+    char message[requestSize];
+    int head[2] = { id, 0 };
+    double target[2] = { x, y };
+    memcpy(message, head, sizeof(head));
+    memcpy(message + sizeof(head), target, sizeof(target));
+    for (size_t done = 0; done < sizeof(message);)
+    {
+        ssize_t put = ::send(fd, message + done, sizeof(message) - done, sendFlags);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return false;
+        done += size_t(put);
+    }
+    return true;
+}
+
+bool IKClient::response(IKResponse & r)
+{
+    int head[2];
+    r.angles.resize(n);
+    if (!readFully(head, sizeof(head)) || !readFully(&r.error, sizeof(r.error)) ||
+        !readFully(&r.angles[0], n * sizeof(double)))
+        return false;
+    r.id = head[0];
+    r.iterations = head[1];
+    return true;
+}
+
+bool IKClient::readFully(void *data, size_t size)
+{
+    char *p = static_cast<char *>(data);
+    for (size_t done = 0; done < size;)
+    {
+        ssize_t got = read(fd, p + done, size - done);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        done += size_t(got);
+    }
+    return true;
+}
+
+void IKClient::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    n = 0;
+}
+
+#else
+
+IKService::~IKService()
+{}
+
+bool IKService::listen(const string &)
+{
+    return false;
+}
+
+void IKService::run()
+{}
+
+bool IKClient::connect(const string &)
+{
+    return false;
+}
+
+bool IKClient::request(int, double, double)
+{
+    return false;
+}
+
+bool IKClient::response(IKResponse &)
+{
+    return false;
+}
+
+void IKClient::close()
+{}
+
+#endif
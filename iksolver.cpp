@@ -0,0 +1,402 @@
+// Interchangeable IK engines for an IKChain.
+
+#include "include/iksolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+const double PI = 4 * atan(1.0);
+
+const char *solverNames[] = { "jacobian", "jacobian-ls", "jacobian-tr", "ccd", "fabrik", "lm", "gauss-newton", 0 };
+
+IKSolver *newSolver(const string & name)
+{
+    if (name == "jacobian")
+        return new JacobianSolver;
+    if (name == "jacobian-ls")
+        return new JacobianSolver(0.01, LINE_SEARCH);
+    if (name == "jacobian-tr")
+        return new JacobianSolver(0.01, TRUST_REGION);
+    if (name == "ccd")
+        return new CCDSolver;
+    if (name == "fabrik")
+        return new FABRIKSolver;
+    if (name == "lm")
+        return new LevenbergMarquardtSolver;
+    if (name == "gauss-newton")
+        return new LevenbergMarquardtSolver(true);
+    return 0;
+}
+
+int IKSolver::solve(IKChain & chain, double tX, double tY, double tolerance, int maxIterations)
+{
+    int it = 0;
+    for (; it < maxIterations; ++it)
+    {
+        chain.forward();
+        double dx = tX - chain.tipX();
+        double dy = tY - chain.tipY();
+        if (dx * dx + dy * dy < tolerance * tolerance)
+            break;
+        iterate(chain, tX, tY);
+    }
+    chain.forward();
+    return it;
+}
+
+JacobianSolver::JacobianSolver(double step, StepControl control)
+    : step(step), control(control), radius(1)
+{}
+
+const char *JacobianSolver::name() const
+{
+    switch (control)
+    {
+        case LINE_SEARCH:
+            return "jacobian-ls";
+        case TRUST_REGION:
+            return "jacobian-tr";
+        default:
+            return "jacobian";
+    }
+}
+
+// Residual distance from the tip to the target after a forward()
+static double residual(IKChain & chain, double tX, double tY)
+{
+    chain.forward();
+    double dx = tX - chain.tipX(), dy = tY - chain.tipY();
+    return sqrt(dx * dx + dy * dy);
+}
+
+bool JacobianSolver::iterate(IKChain & chain, double tX, double tY)
+{
+    double deltaX = tX - chain.tipX();
+    double deltaY = tY - chain.tipY();
+    double dist = sqrt(deltaX * deltaX + deltaY * deltaY);
+    if (dist == 0)
+        return true;
+    if (control == FIXED_STEP)
+    {
+        double rd = step / dist;
+        return chain.solveStep(deltaX * rd, deltaY * rd);
+    }
+
+    // Aim for the target, or for the edge of the trust region, and keep the
+    // joint increments so that the step can be scaled back without another solve
+    const int n = chain.size();
+    saved.assign(chain.jointAngles(), chain.jointAngles() + n);
+    double scale = 1;
+    if (control == TRUST_REGION)
+    {
+        radius = min(radius, chain.reach());
+        if (dist > radius)
+            scale = radius / dist;
+    }
+    bool ok = chain.solveStep(deltaX * scale, deltaY * scale);
+    if (control == TRUST_REGION)
+        project(chain, deltaX * scale, deltaY * scale);
+
+    if (control == LINE_SEARCH)
+    {
+        // Backtrack until the residual shows a sufficient decrease
+        direction.resize(n);
+        for (int i = 0; i < n; ++i)
+            direction[i] = chain.angle(i) - saved[i];
+        double alpha = 1;
+        for (int k = 0; k < 30; ++k)
+        {
+            if (residual(chain, tX, tY) <= (1 - 1e-4 * alpha) * dist)
+                break;
+            alpha *= 0.5;
+            for (int i = 0; i < n; ++i)
+                chain.setAngle(i, saved[i] + alpha * direction[i]);
+        }
+    }
+    else
+    {
+        // Compare the actual reduction with the one the linear model predicts
+        // for the step taken, which joint limits may have clamped
+        double mx = deltaX, my = deltaY;
+        for (int i = 0; i < n; ++i)
+        {
+            double delta = chain.angle(i) - saved[i];
+            mx -= chain.dxda(i) * delta;
+            my -= chain.dyda(i) * delta;
+        }
+        double predicted = dist - sqrt(mx * mx + my * my);
+        double actual = dist - residual(chain, tX, tY);
+        double rho = predicted > 0 ? actual / predicted : 0;
+        if (rho < 0.25)
+        {
+            radius = max(radius / 4, 1e-6);
+            if (rho <= 0)
+                for (int i = 0; i < n; ++i)
+                    chain.setAngle(i, saved[i]);
+        }
+        else if (rho > 0.75 && scale < 1)
+            radius *= 2;
+    }
+    return ok;
+}
+
+// A joint that starts at a limit and that the step pushes further out
+// cannot move, but the step still counted on it, so the tip falls short
+// and the trust region shrinks for nothing.  Solve again with those
+// joints left out of J, as a projected step, keeping the chain's damping.
+// The columns left may be nearly parallel; if the step would then turn a
+// joint by more than the tip may move (a turn of t moves it at most
+// t * reach()), steepest descent over the same joints is taken instead.
+void JacobianSolver::project(IKChain & chain, double dx, double dy)
+{
+    const int n = chain.size();
+    movable.assign(n, 1);
+    bool pinned = false;
+    for (int i = 0; i < n; ++i)
+        if (chain.angle(i) == saved[i] &&
+            (saved[i] == chain.lowerLimit(i) || saved[i] == chain.upperLimit(i)))
+        {
+            movable[i] = 0;
+            pinned = true;
+        }
+    if (!pinned)
+        return;
+
+    // Leaving a joint out can turn the step of another one outward in turn
+    direction.resize(n);
+    double lambda2 = chain.damping() * chain.damping();
+    bool solved = false;
+    for (int pass = 0; pass < n && !solved; ++pass)
+    {
+        double a = lambda2, b = 0, d = lambda2;
+        for (int i = 0; i < n; ++i)
+            if (movable[i])
+            {
+                a += chain.dxda(i) * chain.dxda(i);
+                b += chain.dxda(i) * chain.dyda(i);
+                d += chain.dyda(i) * chain.dyda(i);
+            }
+        double det = a * d - b * b;
+        if (det == 0)
+            break;
+        double wx = ( d * dx - b * dy) / det;
+        double wy = (-b * dx + a * dy) / det;
+        solved = true;
+        for (int i = 0; i < n; ++i)
+        {
+            direction[i] = movable[i] ? chain.dxda(i) * wx + chain.dyda(i) * wy : 0;
+            if ((saved[i] == chain.lowerLimit(i) && direction[i] < 0) ||
+                (saved[i] == chain.upperLimit(i) && direction[i] > 0))
+            {
+                movable[i] = 0;
+                solved = false;
+            }
+        }
+    }
+
+    double maxTurn = sqrt(dx * dx + dy * dy) / chain.reach();
+    double turn = 0;
+    for (int i = 0; solved && i < n; ++i)
+        turn = max(turn, fabs(direction[i]));
+    if (!solved || turn > maxTurn)
+    {
+        // The gradient J^T e over the movable joints, taken as far as the
+        // linear model keeps improving or the turn limit allows
+        double mx = 0, my = 0, g2 = 0;
+        turn = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            direction[i] = movable[i] ? chain.dxda(i) * dx + chain.dyda(i) * dy : 0;
+            mx += chain.dxda(i) * direction[i];
+            my += chain.dyda(i) * direction[i];
+            g2 += direction[i] * direction[i];
+            turn = max(turn, fabs(direction[i]));
+        }
+        if (g2 == 0)
+            return;
+        double alpha = min(g2 / (mx * mx + my * my), maxTurn / turn);
+        for (int i = 0; i < n; ++i)
+            direction[i] *= alpha;
+    }
+    for (int i = 0; i < n; ++i)
+        chain.setAngle(i, saved[i] + direction[i]);
+}
+
+bool CCDSolver::iterate(IKChain & chain, double tX, double tY)
+{
+    // Joints before i do not move when joint i turns, so one forward() is
+    // enough for the whole sweep: only the tip has to be tracked.  It turns
+    // by the angle setAngle() actually applied, which a limit may cut short.
+    double x = chain.tipX();
+    double y = chain.tipY();
+    for (int i = chain.size() - 1; i >= 0; --i)
+    {
+        double jX = chain.jointX(i), jY = chain.jointY(i);
+        double ex = x - jX, ey = y - jY;
+        double gx = tX - jX, gy = tY - jY;
+        double phi = atan2(ex * gy - ey * gx, ex * gx + ey * gy);
+        double old = chain.angle(i);
+        chain.setAngle(i, old + phi);
+        phi = chain.angle(i) - old;
+        double c = cos(phi), s = sin(phi);
+        x = jX + c * ex - s * ey;
+        y = jY + s * ex + c * ey;
+    }
+    return true;
+}
+
+bool FABRIKSolver::iterate(IKChain & chain, double tX, double tY)
+{
+    const int n = chain.size();
+    if (int(px.size()) < n + 1)
+    {
+        px.resize(n + 1);
+        py.resize(n + 1);
+    }
+    for (int i = 0; i <= n; ++i)
+    {
+        px[i] = chain.jointX(i);
+        py[i] = chain.jointY(i);
+    }
+
+    // Backward pass: pin the tip to the target
+    px[n] = tX;
+    py[n] = tY;
+    for (int i = n - 1; i >= 0; --i)
+    {
+        double dx = px[i] - px[i + 1], dy = py[i] - py[i + 1];
+        double d = sqrt(dx * dx + dy * dy);
+        double r = d > 0 ? chain.length(i) / d : 0;
+        px[i] = px[i + 1] + dx * r;
+        py[i] = py[i + 1] + dy * r;
+    }
+
+    // Forward pass: pin the base back to the origin and recover the angles.
+    // Each link is placed along the direction its joint actually took, which
+    // a limit may have clamped, so the links after it start from there.
+    px[0] = 0;
+    py[0] = 0;
+    double previous = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        double dx = px[i + 1] - px[i], dy = py[i + 1] - py[i];
+        double theta = atan2(dy, dx);
+
+        // Keep the joint angle continuous rather than wrapping it to (-pi, pi]
+        double a = theta - previous - chain.angle(i);
+        a -= 2 * PI * floor((a + PI) / (2 * PI));
+        chain.setAngle(i, chain.angle(i) + a);
+        previous += chain.angle(i);
+        px[i + 1] = px[i] + chain.length(i) * cos(previous);
+        py[i + 1] = py[i] + chain.length(i) * sin(previous);
+    }
+    return true;
+}
+
+LevenbergMarquardtSolver::LevenbergMarquardtSolver(bool gaussNewton)
+    : gaussNewton(gaussNewton), mu(-1), nu(2), lastX(0), lastY(0)
+{
+    last.iterations = 0;
+    last.rejected = 0;
+    last.converged = false;
+    last.seconds = 0;
+}
+
+bool LevenbergMarquardtSolver::iterate(IKChain & chain, double tX, double tY)
+{
+    const int n = chain.size();
+    double ex = tX - chain.tipX(), ey = tY - chain.tipY();
+    double error = ex * ex + ey * ey;
+    if (error == 0)
+        return true;
+    double a = 0, b = 0, c = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        a += chain.dxda(i) * chain.dxda(i);
+        b += chain.dxda(i) * chain.dyda(i);
+        c += chain.dyda(i) * chain.dyda(i);
+    }
+    // A new target starts the damping afresh, as solve() does
+    if (tX != lastX || tY != lastY)
+    {
+        mu = -1;
+        nu = 2;
+        lastX = tX;
+        lastY = tY;
+    }
+    if (mu < 0)
+        mu = 1e-3 * max(a, c);
+
+    saved.assign(chain.jointAngles(), chain.jointAngles() + n);
+    for (int attempt = 0; attempt < 30; ++attempt)
+    {
+        // Gauss-Newton falls back on a tiny damping only where J J^T is singular
+        double m = gaussNewton ? 0 : mu;
+        double det = (a + m) * (c + m) - b * b;
+        bool singular = !(fabs(det) > 1e-12 * (a + c) * (a + c));
+        if (singular)
+        {
+            m = max(m, 1e-6 * (a + c) + 1e-12);
+            det = (a + m) * (c + m) - b * b;
+        }
+        double wx = ((c + m) * ex - b * ey) / det;
+        double wy = ((a + m) * ey - b * ex) / det;
+        for (int i = 0; i < n; ++i)
+            chain.setAngle(i, saved[i] + chain.dxda(i) * wx + chain.dyda(i) * wy);
+        if (gaussNewton)
+            return !singular;
+
+        // Gain ratio: the actual drop in squared residual over the drop the
+        // linear model predicted, which is |e|^2 - mu^2 |w|^2
+        double r = residual(chain, tX, tY);
+        double predicted = error - m * m * (wx * wx + wy * wy);
+        double rho = predicted > 0 ? (error - r * r) / predicted : -1;
+        if (rho > 0)
+        {
+            double t = 2 * rho - 1;
+            mu *= max(1.0 / 3, 1 - t * t * t);
+            nu = 2;
+            return !singular;
+        }
+        for (int i = 0; i < n; ++i)
+            chain.setAngle(i, saved[i]);
+        chain.forward();
+        mu = min(mu * nu, 1e12 * (a + c) + 1);
+        nu = min(nu * 2, 1e6);
+        ++last.rejected;
+    }
+
+    // No step was accepted: leave the chain where it was and start the
+    // damping afresh next time rather than from an ever larger mu
+    mu = -1;
+    nu = 2;
+    return false;
+}
+
+int LevenbergMarquardtSolver::solve(IKChain & chain, double tX, double tY, double tolerance, int maxIterations)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    mu = -1;
+    nu = 2;
+    lastX = tX;
+    lastY = tY;
+    last.rejected = 0;
+    last.converged = false;
+    last.residuals.clear();
+    int it = 0;
+    for (;; ++it)
+    {
+        double r = residual(chain, tX, tY);
+        last.residuals.push_back(r);
+        last.converged = r < tolerance;
+        if (last.converged || it == maxIterations)
+            break;
+        iterate(chain, tX, tY);
+    }
+    last.iterations = it;
+    last.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return it;
+}
@@ -0,0 +1,296 @@
+// Solve a continuous stream of targets read from stdin, a file or a Unix socket.
+
+#include "include/ikstream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+namespace
+{
+    struct Target
+    {
+        long seq;
+        double x, y;
+        Clock::time_point received;
+    };
+
+    // A queue of at most capacity targets.  push() waits for room and
+    // popBatch() for at least one target or the end of the stream.
+    class TargetQueue
+    {
+    public:
+        explicit TargetQueue(int capacity) : capacity(max(capacity, 1)), closed(false), highWater(0), blocked(0) {}
+
+        void push(const Target & t)
+        {
+            unique_lock<mutex> guard(lock);
+            if (int(queue.size()) >= capacity)
+            {
+                Clock::time_point begin = Clock::now();
+                roomy.wait(guard, [&] { return int(queue.size()) < capacity; });
+                blocked += chrono::duration<double>(Clock::now() - begin).count();
+            }
+            queue.push_back(t);
+            highWater = max(highWater, int(queue.size()));
+            guard.unlock();
+            ready.notify_one();
+        }
+
+        void close()
+        {
+            {
+                lock_guard<mutex> guard(lock);
+                closed = true;
+            }
+            ready.notify_one();
+        }
+
+        // Move up to most targets into batch; false once the stream has ended
+        bool popBatch(vector<Target> & batch, int most)
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [&] { return closed || !queue.empty(); });
+            batch.clear();
+            while (!queue.empty() && int(batch.size()) < most)
+            {
+                batch.push_back(queue.front());
+                queue.pop_front();
+            }
+            guard.unlock();
+            roomy.notify_one();
+            return !batch.empty();
+        }
+
+        int capacity;
+        bool closed;
+        int highWater;
+        double blocked;     // written by the reader only
+
+    private:
+        mutex lock;
+        condition_variable ready;
+        condition_variable roomy;
+        deque<Target> queue;
+    };
+
+    // The reader: one target per line, "x y" or "x,y"; blank lines and lines starting with # are skipped
+    void readTargets(FILE *in, TargetQueue & queue, long & malformed)
+    {
+        char line[256];
+        long seq = 0;
+        while (fgets(line, sizeof(line), in))
+        {
+            char *p = line;
+            while (*p == ' ' || *p == '\t')
+                ++p;
+            if (*p == '\n' || *p == '\r' || *p == '#' || *p == 0)
+                continue;
+            char *end;
+            Target t;
+            t.x = strtod(p, &end);
+            bool ok = end != p;
+            p = end;
+            while (*p == ' ' || *p == '\t' || *p == ',')
+                ++p;
+            t.y = strtod(p, &end);
+            ok = ok && end != p && std::isfinite(t.x) && std::isfinite(t.y);
+            if (!ok)
+            {
+                ++malformed;
+                continue;
+            }
+            t.seq = seq++;
+            t.received = Clock::now();
+            queue.push(t);
+        }
+        queue.close();
+    }
+
+    // Append the record for one solved target to buffer
+    void format(vector<char> & buffer, const Target & t, int iterations, double error, const IKChain & chain, bool binary)
+    {
+        int n = chain.size();
+        if (binary)
+        {
+            int head[2] = { int(t.seq), iterations };
+            size_t at = buffer.size();
+            buffer.resize(at + sizeof(head) + (n + 1) * sizeof(float));
+            memcpy(&buffer[at], head, sizeof(head));
+            at += sizeof(head);
+
+            // The buffer gives no float alignment, so the values are copied in
+            float value = float(error);
+            memcpy(&buffer[at], &value, sizeof(value));
+            for (int i = 0; i < n; ++i)
+            {
+                value = float(chain.angle(i));
+                memcpy(&buffer[at + (i + 1) * sizeof(value)], &value, sizeof(value));
+            }
+            return;
+        }
+        char field[32];
+        int length = snprintf(field, sizeof(field), "%ld,%d,%.6g", t.seq, iterations, error);
+        buffer.insert(buffer.end(), field, field + length);
+        for (int i = 0; i < n; ++i)
+        {
+            length = snprintf(field, sizeof(field), ",%.9g", chain.angle(i));
+            buffer.insert(buffer.end(), field, field + length);
+        }
+        buffer.push_back('\n');
+    }
+
+    // The p-th percentile of the values, which are reordered
+    double percentile(vector<double> & values, double p)
+    {
+        if (values.empty())
+            return 0;
+        size_t k = min(values.size() - 1, size_t(p * values.size()));
+        nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+}
+
+StreamReport runStream(IKChain & chain, IKSolver & solver, FILE *in, FILE *out, const StreamOptions & options)
+{
+    StreamReport report;
+    report.targets = 0;
+    report.malformed = 0;
+    report.unreached = 0;
+    report.batches = 0;
+
+    TargetQueue queue(options.capacity);
+    thread reader(readTargets, in, ref(queue), ref(report.malformed));
+
+    TargetTracker tracker;
+    vector<Target> batch;
+    vector<char> buffer;
+    vector<double> latencies;
+    Clock::time_point first, last;
+    while (queue.popBatch(batch, max(options.batch, 1)))
+    {
+        if (report.batches++ == 0)
+            first = batch[0].received;
+        buffer.clear();
+        for (size_t k = 0; k < batch.size(); ++k)
+        {
+            const Target & t = batch[k];
+            if (options.table)
+                options.table->warmStart(chain, t.x, t.y);
+            int it = solver.solve(chain, t.x, t.y, options.tolerance, options.maxIterations);
+            double error = hypot(t.x - chain.tipX(), t.y - chain.tipY());
+            if (error >= options.tolerance)
+                ++report.unreached;
+            format(buffer, t, it, error, chain, options.binary);
+            if (options.predict)
+            {
+                tracker.observe(t.x, t.y);
+                leadTarget(chain, tracker);
+            }
+        }
+        if (!buffer.empty() && fwrite(&buffer[0], 1, buffer.size(), out) != buffer.size())
+            break;
+        fflush(out);
+        last = Clock::now();
+        for (size_t k = 0; k < batch.size(); ++k)
+            latencies.push_back(chrono::duration<double, micro>(last - batch[k].received).count());
+        report.targets += long(batch.size());
+    }
+
+    // A write failure leaves the reader to run to the end of its input
+    while (queue.popBatch(batch, queue.capacity))
+        ;
+    reader.join();
+
+    report.seconds = report.batches ? chrono::duration<double>(last - first).count() : 0;
+    report.worst = latencies.empty() ? 0 : *max_element(latencies.begin(), latencies.end());
+    report.p50 = percentile(latencies, 0.50);
+    report.p99 = percentile(latencies, 0.99);
+    report.highWater = queue.highWater;
+    report.blocked = queue.blocked;
+    return report;
+}
+
+bool acceptUnixSocket(const string & path, FILE *& in, FILE *& out)
+{
+#ifdef _WIN32
+    (void)path;
+    (void)in;
+    (void)out;
+    return false;
+#else
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0)
+        return false;
+    unlink(path.c_str());
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(server, 1) < 0)
+    {
+        close(server);
+        return false;
+    }
+    int client = accept(server, 0, 0);
+    close(server);
+    unlink(path.c_str());
+    if (client < 0)
+        return false;
+    int copy = dup(client);
+    in = fdopen(client, "r");
+    out = copy < 0 ? 0 : fdopen(copy, "w");
+    if (!in || !out)
+    {
+        if (in)
+            fclose(in);
+        else
+            close(client);
+        if (out)
+            fclose(out);
+        else if (copy >= 0)
+            close(copy);
+        return false;
+    }
+    return true;
+#endif
+}
+
+void printStreamReport(ostream & os, const StreamReport & r, bool json)
+{
+    double rate = r.seconds > 0 ? r.targets / r.seconds : 0;
+    if (json)
+    {
+        os << "{\"targets\": " << r.targets << ", \"malformed\": " << r.malformed << ", "
+           << "\"unreached\": " << r.unreached << ", \"batches\": " << r.batches << ", "
+           << "\"seconds\": " << r.seconds << ", \"targets_per_second\": " << rate << ", "
+           << "\"latency_us\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"max\": " << r.worst << "}, "
+           << "\"queue_high_water\": " << r.highWater << ", \"reader_blocked_seconds\": " << r.blocked << "}" << endl;
+        return;
+    }
+    os << "targets " << r.targets << ", malformed " << r.malformed << ", unreached " << r.unreached
+       << ", batches " << r.batches << endl
+       << "time " << r.seconds << " s, " << rate << " targets/s" << endl
+       << "latency p50 " << r.p50 << " us, p99 " << r.p99 << " us, max " << r.worst << " us" << endl
+       << "queue high water " << r.highWater << ", reader blocked " << r.blocked << " s" << endl;
+}
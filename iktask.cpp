@@ -0,0 +1,121 @@
+// A small work-stealing thread pool for running many independent IK solves.
+
+#include "include/iktask.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TaskPool::TaskPool(int threads)
+    : workers(threads > 0 ? threads : max(1, int(thread::hardware_concurrency()))),
+      stealing(true), stopping(false), generation(0), body(0), pending(0)
+{
+    for (int w = 0; w < workers; ++w)
+        queues.push_back(unique_ptr<Queue>(new Queue));
+    for (int w = 1; w < workers; ++w)
+        pool.push_back(thread(&TaskPool::run, this, w));
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        lock_guard<mutex> guard(sleep);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+}
+
+void TaskPool::parallelFor(int count, const function<void(int)> & f, int grain)
+{
+    if (count <= 0)
+        return;
+    grain = max(grain, 1);
+    int chunks = (count + grain - 1) / grain;
+
+    // The body is published before any chunk, since a worker still leaving
+    // the previous call may find one.  Worker w gets chunks
+    // [w * chunks / workers, (w + 1) * chunks / workers).
+    body = &f;
+    pending = chunks;
+    for (int w = 0; w < workers; ++w)
+    {
+        lock_guard<mutex> guard(queues[w]->lock);
+        for (int k = w * chunks / workers; k < (w + 1) * chunks / workers; ++k)
+        {
+            Chunk c = { k * grain, min(count, (k + 1) * grain) };
+            queues[w]->chunks.push_back(c);
+        }
+    }
+    {
+        lock_guard<mutex> guard(sleep);
+        ++generation;
+    }
+    wake.notify_all();
+    drain(0);
+}
+
+void TaskPool::run(int w)
+{
+    unsigned long seen = 0;
+    for (;;)
+    {
+        {
+            unique_lock<mutex> guard(sleep);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        drain(w);
+    }
+}
+
+void TaskPool::drain(int w)
+{
+    // Spin until every chunk has finished, not just until the queues are
+    // empty, so that parallelFor() does not return while others still run
+    Chunk c;
+    while (pending > 0)
+    {
+        if (pop(w, c) || (stealing && steal(w, c)))
+        {
+            const function<void(int)> & f = *body;
+            for (int i = c.begin; i < c.end; ++i)
+                f(i);
+            ++queues[w]->executed;
+            --pending;
+        }
+        else
+            this_thread::yield();
+    }
+}
+
+bool TaskPool::pop(int w, Chunk & c)
+{
+    Queue & q = *queues[w];
+    lock_guard<mutex> guard(q.lock);
+    if (q.chunks.empty())
+        return false;
+    c = q.chunks.back();
+    q.chunks.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(int w, Chunk & c)
+{
+    for (int k = 1; k < workers; ++k)
+    {
+        Queue & q = *queues[(w + k) % workers];
+        lock_guard<mutex> guard(q.lock);
+        if (!q.chunks.empty())
+        {
+            c = q.chunks.front();
+            q.chunks.pop_front();
+            ++queues[w]->stolen;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,194 @@
+// Planar inverse kinematics for a branching tree of links with several end effectors.
+
+#include "include/iktree.h"
+#include "include/iksimd.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+IKTree::IKTree() : n(0), damping(-1), longest(0)
+{}
+
+int IKTree::addJoint(int parent, double length, double initialAngle)
+{
+    int i = n++;
+    parents.push_back(parent);
+    depth.push_back(parent < 0 ? 0 : depth[parent] + 1);
+    ancestorStart.push_back(int(ancestors.size()));
+    if (parent >= 0)
+    {
+        ancestors.push_back(parent);
+        for (int t = 0; t < depth[parent]; ++t)
+            ancestors.push_back(ancestors[ancestorStart[parent] + t]);
+    }
+    lower.resize(ancestors.size());
+
+    lengths.push_back(length);
+    pathLength.push_back((parent < 0 ? 0 : pathLength[parent]) + length);
+    longest = max(longest, pathLength[i]);
+    angles.push_back(initialAngle);
+    theta.push_back(0);
+    sines.push_back(0);
+    cosines.push_back(0);
+    ex.push_back(0);
+    ey.push_back(0);
+    diagonal.push_back(0);
+    rhs.push_back(0);
+    return i;
+}
+
+int IKTree::addEffector(int joint)
+{
+    forward();
+    effectorJoint.push_back(joint);
+    targetX.push_back(ex[joint]);
+    targetY.push_back(ey[joint]);
+    columnStart.push_back(int(jx.size()));
+    jx.resize(jx.size() + depth[joint] + 1);
+    jy.resize(jy.size() + depth[joint] + 1);
+    return int(effectorJoint.size()) - 1;
+}
+
+void IKTree::setTarget(int e, double x, double y)
+{
+    targetX[e] = x;
+    targetY[e] = y;
+}
+
+void IKTree::forward()
+{
+    if (n == 0)
+        return;
+    for (int i = 0; i < n; ++i)
+        theta[i] = (parents[i] < 0 ? 0 : theta[parents[i]]) + angles[i];
+    sinCos(&theta[0], &sines[0], &cosines[0], n);
+    for (int i = 0; i < n; ++i)
+    {
+        int p = parents[i];
+        ex[i] = (p < 0 ? 0 : ex[p]) + lengths[i] * cosines[i];
+        ey[i] = (p < 0 ? 0 : ey[p]) + lengths[i] * sines[i];
+    }
+
+    // Column k of effector e is the effector relative to the base of link k, rotated by 90 degrees
+    for (int e = 0; e < effectors(); ++e)
+    {
+        int j = effectorJoint[e];
+        double x = ex[j], y = ey[j];
+        double *cx = &jx[columnStart[e]], *cy = &jy[columnStart[e]];
+        for (int t = 0, k = j; t <= depth[j]; ++t, k = parents[k])
+        {
+            int p = parents[k];
+            cx[t] = (p < 0 ? 0 : ey[p]) - y;
+            cy[t] = x - (p < 0 ? 0 : ex[p]);
+        }
+    }
+}
+
+double IKTree::error() const
+{
+    double worst = 0;
+    for (int e = 0; e < effectors(); ++e)
+    {
+        double dx = targetX[e] - effectorX(e), dy = targetY[e] - effectorY(e);
+        worst = max(worst, dx * dx + dy * dy);
+    }
+    return sqrt(worst);
+}
+
+bool IKTree::solveStep(double step)
+{
+    double lambda = damping < 0 ? 0.01 * longest : damping;
+    fill(diagonal.begin(), diagonal.end(), lambda * lambda);
+    fill(lower.begin(), lower.end(), 0.0);
+    fill(rhs.begin(), rhs.end(), 0.0);
+
+    // Accumulate J^T J and J^T e one effector at a time.  Along the path
+    // k_0 = j, k_1 = parent(j), ..., joint k_s (s > t) is at position
+    // s - t - 1 of k_t's ancestor list.
+    for (int e = 0; e < effectors(); ++e)
+    {
+        int j = effectorJoint[e];
+        double dx = targetX[e] - ex[j], dy = targetY[e] - ey[j];
+        double d = sqrt(dx * dx + dy * dy);
+        if (d > step)
+        {
+            dx *= step / d;
+            dy *= step / d;
+        }
+        const double *cx = &jx[columnStart[e]], *cy = &jy[columnStart[e]];
+        const int *path = &ancestors[ancestorStart[j]];
+        for (int t = 0; t <= depth[j]; ++t)
+        {
+            int k = t ? path[t - 1] : j;
+            rhs[k] += cx[t] * dx + cy[t] * dy;
+            diagonal[k] += cx[t] * cx[t] + cy[t] * cy[t];
+            double *row = &lower[ancestorStart[k]];
+            for (int s = t + 1; s <= depth[j]; ++s)
+                row[s - t - 1] += cx[t] * cx[s] + cy[t] * cy[s];
+        }
+    }
+
+    if (!factor())
+        return false;
+
+    // Forward substitution from the leaves, then back substitution from the roots
+    for (int j = n - 1; j >= 0; --j)
+    {
+        rhs[j] /= diagonal[j];
+        const int *anc = &ancestors[ancestorStart[j]];
+        const double *row = &lower[ancestorStart[j]];
+        for (int t = 0; t < depth[j]; ++t)
+            rhs[anc[t]] -= row[t] * rhs[j];
+    }
+    for (int j = 0; j < n; ++j)
+    {
+        const int *anc = &ancestors[ancestorStart[j]];
+        const double *row = &lower[ancestorStart[j]];
+        double sum = rhs[j];
+        for (int t = 0; t < depth[j]; ++t)
+            sum -= row[t] * rhs[anc[t]];
+        rhs[j] = sum / diagonal[j];
+        angles[j] += rhs[j];
+    }
+    return true;
+}
+
+bool IKTree::factor()
+{
+    // Eliminate joints from the highest index, so every descendant of a
+    // joint goes before it.  The ancestors of joint j are all ancestors of
+    // one another, so the update touches only entries that already exist.
+    for (int j = n - 1; j >= 0; --j)
+    {
+        if (!(diagonal[j] > 0))
+            return false;
+        double d = sqrt(diagonal[j]);
+        diagonal[j] = d;
+        const int *anc = &ancestors[ancestorStart[j]];
+        double *row = &lower[ancestorStart[j]];
+        for (int t = 0; t < depth[j]; ++t)
+            row[t] /= d;
+        for (int t = 0; t < depth[j]; ++t)
+        {
+            int k = anc[t];
+            diagonal[k] -= row[t] * row[t];
+            double *krow = &lower[ancestorStart[k]];
+            for (int u = t + 1; u < depth[j]; ++u)
+                krow[u - t - 1] -= row[t] * row[u];
+        }
+    }
+    return true;
+}
+
+int IKTree::solve(double step, double tolerance, int maxIterations)
+{
+    int it = 0;
+    for (forward(); it < maxIterations && error() >= tolerance; ++it)
+    {
+        solveStep(step);
+        forward();
+    }
+    return it;
+}
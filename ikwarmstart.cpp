@@ -0,0 +1,218 @@
+// A precomputed table of joint configurations over the workspace, for warm starts.
+
+#include "include/ikwarmstart.h"
+#include "include/iksolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+static const char magic[8] = { 'I', 'K', 'L', 'U', 'T', '1', 0, 0 };
+
+WorkspaceTable::WorkspaceTable() : n(0), res(0), extent(0)
+{}
+
+int WorkspaceTable::build(const IKChain & chain, int resolution, double tolerance)
+{
+    n = chain.size();
+    res = max(resolution, 2);
+    extent = chain.reach();
+    lengths.assign(n, 0);
+    for (int i = 0; i < n; ++i)
+        lengths[i] = chain.length(i);
+    table.assign(size_t(res) * res * n, 0);
+    valid.assign(size_t(res) * res, 0);
+
+    // Nodes nearer the base than the links can fold, or beyond the reach, are skipped
+    double longest = *max_element(lengths.begin(), lengths.end());
+    double inner = max(0.0, 2 * longest - extent);
+
+    // Each node starts from a canonical pose that depends only on the node:
+    // every joint after the base bends by the same k, chosen so that the
+    // tip is at the node's radius, and the base turns it to the node's
+    // direction.  Solutions then vary smoothly from node to node and can
+    // be blended.  Radius and direction of the bent arm are tabulated for
+    // k from 0 up to the bend where the radius stops shrinking.
+    IKChain arm(lengths);
+    vector<double> bend, radius, direction;
+    for (int k = 0; k <= 256; ++k)
+    {
+        double kappa = 4 * atan(1.0) * k / 256;
+        for (int i = 0; i < n; ++i)
+            arm.setAngle(i, i ? kappa : 0);
+        arm.forward();
+        double r = sqrt(arm.tipX() * arm.tipX() + arm.tipY() * arm.tipY());
+        if (k > 0 && r >= radius.back())
+            break;
+        bend.push_back(kappa);
+        radius.push_back(r);
+        direction.push_back(atan2(arm.tipY(), arm.tipX()));
+    }
+
+    arm.setMethod(DAMPED_LEAST_SQUARES);
+    JacobianSolver solver(0.01, LINE_SEARCH);
+    int reached = 0;
+    for (int row = 0; row < res; ++row)
+        for (int col = 0; col < res; ++col)
+        {
+            double x = -extent + 2 * extent * col / (res - 1);
+            double y = -extent + 2 * extent * row / (res - 1);
+            double r = sqrt(x * x + y * y);
+            if (r < inner || r > 0.999 * extent)
+                continue;
+
+            size_t k = 0;
+            while (k + 1 < radius.size() && radius[k + 1] >= r)
+                ++k;
+            for (int i = 0; i < n; ++i)
+                arm.setAngle(i, i ? bend[k] : atan2(y, x) - direction[k]);
+            solver.solve(arm, x, y, tolerance, 2000);
+            double dx = x - arm.tipX(), dy = y - arm.tipY();
+            if (dx * dx + dy * dy >= tolerance * tolerance)
+                continue;
+            int node = row * res + col;
+            for (int i = 0; i < n; ++i)
+                table[node * n + i] = float(arm.angle(i));
+            valid[node] = 1;
+            ++reached;
+        }
+    return reached;
+}
+
+bool WorkspaceTable::save(const string & path) const
+{
+    if (res == 0)
+        return false;
+    ofstream out(path.c_str(), ios::binary);
+    int header[2] = { n, res };
+    out.write(magic, sizeof(magic));
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&extent), sizeof(extent));
+    out.write(reinterpret_cast<const char *>(&lengths[0]), n * sizeof(double));
+    out.write(reinterpret_cast<const char *>(&valid[0]), valid.size());
+    out.write(reinterpret_cast<const char *>(&table[0]), table.size() * sizeof(float));
+    return bool(out);
+}
+
+bool WorkspaceTable::load(const string & path)
+{
+    ifstream in(path.c_str(), ios::binary);
+    char check[sizeof(magic)];
+    int header[2];
+    if (!in.read(check, sizeof(check)) || memcmp(check, magic, sizeof(magic)) != 0 ||
+        !in.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[0] < 1 || header[0] > 65536 || header[1] < 2 || header[1] > 65536)
+        return false;
+
+    // The header must describe exactly the rest of the file before anything
+    // is allocated, so a corrupt or truncated table fails rather than throws
+    int links = header[0], resolution = header[1];
+    unsigned long long nodes = (unsigned long long)resolution * resolution;
+    unsigned long long payload = sizeof(double) + links * sizeof(double) + nodes * (1 + links * sizeof(float));
+    streampos here = in.tellg();
+    in.seekg(0, ios::end);
+    streampos end = in.tellg();
+    if (here < 0 || end < here || (unsigned long long)(end - here) != payload)
+        return false;
+    in.seekg(here);
+
+    double size;
+    vector<double> ls(links);
+    vector<unsigned char> v(size_t(resolution) * resolution);
+    vector<float> t(v.size() * links);
+    if (!in.read(reinterpret_cast<char *>(&size), sizeof(size)) || !(size > 0) || !isfinite(size) ||
+        !in.read(reinterpret_cast<char *>(&ls[0]), links * sizeof(double)) ||
+        !in.read(reinterpret_cast<char *>(&v[0]), v.size()) ||
+        !in.read(reinterpret_cast<char *>(&t[0]), t.size() * sizeof(float)))
+        return false;
+
+    n = links;
+    res = resolution;
+    extent = size;
+    lengths.swap(ls);
+    valid.swap(v);
+    table.swap(t);
+    return true;
+}
+
+bool WorkspaceTable::matches(const IKChain & chain) const
+{
+    if (chain.size() != n)
+        return false;
+    for (int i = 0; i < n; ++i)
+        if (fabs(chain.length(i) - lengths[i]) > 1e-9 * extent)
+            return false;
+    return true;
+}
+
+int WorkspaceTable::reachedNodes() const
+{
+    return int(count(valid.begin(), valid.end(), 1));
+}
+
+int WorkspaceTable::cell(double x, double y, int node[4], double weight[4]) const
+{
+    // Grid coordinates of the target, clamped to the grid
+    double u = min(max((x + extent) / (2 * extent) * (res - 1), 0.0), res - 1.0);
+    double v = min(max((y + extent) / (2 * extent) * (res - 1), 0.0), res - 1.0);
+    int col = min(int(u), res - 2), row = min(int(v), res - 2);
+    double fu = u - col, fv = v - row;
+
+    // Unreached corners are dropped and the remaining weights rescaled
+    const int nodes[4] = { row * res + col, row * res + col + 1, (row + 1) * res + col, (row + 1) * res + col + 1 };
+    const double weights[4] = { (1 - fu) * (1 - fv), fu * (1 - fv), (1 - fu) * fv, fu * fv };
+    int corners = 0;
+    double total = 0;
+    for (int k = 0; k < 4; ++k)
+        if (valid[nodes[k]])
+        {
+            node[corners] = nodes[k];
+            weight[corners] = weights[k];
+            total += weights[k];
+            ++corners;
+        }
+    for (int k = 0; k < corners; ++k)
+        weight[k] = total > 0 ? weight[k] / total : 1.0 / corners;
+    return corners;
+}
+
+double WorkspaceTable::interpolate(int i, const int node[4], const double weight[4], int corners) const
+{
+    // Corners are taken to within pi of the first, so a wrap of 2 pi does not blend to nonsense
+    const double twoPi = 8 * atan(1.0);
+    double first = table[node[0] * n + i];
+    double a = 0;
+    for (int k = 0; k < corners; ++k)
+    {
+        double b = table[node[k] * n + i];
+        a += weight[k] * (b + twoPi * floor((first - b) / twoPi + 0.5));
+    }
+    return a;
+}
+
+bool WorkspaceTable::lookup(double x, double y, double angles[]) const
+{
+    int node[4];
+    double weight[4];
+    int corners = res ? cell(x, y, node, weight) : 0;
+    if (corners == 0)
+        return false;
+    for (int i = 0; i < n; ++i)
+        angles[i] = interpolate(i, node, weight, corners);
+    return true;
+}
+
+bool WorkspaceTable::warmStart(IKChain & chain, double x, double y) const
+{
+    int node[4];
+    double weight[4];
+    int corners = res && chain.size() == n ? cell(x, y, node, weight) : 0;
+    if (corners == 0)
+        return false;
+    for (int i = 0; i < n; ++i)
+        chain.setAngle(i, interpolate(i, node, weight, corners));
+    return true;
+}
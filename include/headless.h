@@ -0,0 +1,99 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+/** \file headless.h
+ *  Drive an IK engine without a window, for benchmarking on machines with no GL context.
+ *
+ *  The loop is the one idle() runs: evaluate the tip, pick a new target
+ *  when the tip is within tolerance, otherwise perform one solver
+ *  iteration.  Each iteration is timed individually.  A run can be
+ *  recorded, and a recording replayed to check that the solver still
+ *  produces the same angles and to compare its timing.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ikchain.h"
+#include "ikrandom.h"
+#include "ikreach.h"
+#include "ikrecord.h"
+#include "iksolver.h"
+#include "ikwarmstart.h"
+
+/** Limits and settings for a headless run. */
+struct HeadlessOptions
+{
+    HeadlessOptions()
+        : targets(1000), steps(0), seed(12345678), tolerance(0.1), maxIterations(100000), json(false), table(0), reach(0), clampTargets(false), recorder(0)
+    {}
+
+    long targets;           /**< Stop after this many targets have been reached or abandoned (0 for no limit). */
+    long steps;             /**< Stop after this many solver iterations (0 for no limit). */
+    unsigned int seed;      /**< Seed of the target generator. */
+    double tolerance;       /**< Distance at which a target counts as reached. */
+    long maxIterations;     /**< Abandon a target after this many iterations. */
+    bool json;              /**< Report in JSON rather than text. */
+    const WorkspaceTable *table;    /**< If set, warm start the chain from this table at each new target. */
+    const ReachabilityMap *reach;   /**< If set, screen targets against this map before solving. */
+    bool clampTargets;              /**< Move unreachable targets into reach rather than drawing new ones. */
+    SessionRecorder *recorder;      /**< If set, record the targets and every iteration. */
+};
+
+/** Results of a headless run. */
+struct HeadlessReport
+{
+    std::string solver;
+    std::string method;
+    int links;
+    unsigned int seed;
+    long steps;
+    long reached;
+    long abandoned;
+    long singularities;
+    long screened;                  /**< Targets redrawn or clamped because the map marks them unreachable. */
+    double seconds;
+    double p50;                     /**< Median iteration latency in nanoseconds. */
+    double p99;                     /**< 99th percentile iteration latency in nanoseconds. */
+    double worst;                   /**< Longest iteration in nanoseconds. */
+    std::vector<long> histogram;    /**< Bucket k counts targets that took [2^k, 2^(k+1)) iterations; bucket 0 includes 0. */
+};
+
+/**
+ * Run \a solver on \a chain against targets from \a rng until one of the
+ * limits in \a options is met.
+ */
+HeadlessReport runHeadless(IKChain & chain, IKSolver & solver, IKRandom & rng, const HeadlessOptions & options);
+
+/** Write \a report to \a os as text or, if \a json is true, as a JSON object. */
+void printReport(std::ostream & os, const HeadlessReport & report, bool json);
+
+/** Results of replaying a recording. */
+struct ReplayReport
+{
+    std::string solver;
+    int links;
+    unsigned int seed;
+    long targets;
+    long steps;
+    bool complete;                  /**< False if the recording ended in a malformed event. */
+    long mismatches;                /**< Steps whose angles differ from the recording by more than a quantum. */
+    long firstMismatch;             /**< Index of the first such step, or -1. */
+    double deviation;               /**< Largest difference from a recorded angle in radians. */
+    double recordedP50, recordedP99, recordedWorst;     /**< Recorded iteration latencies in nanoseconds. */
+    double p50, p99, worst;                             /**< Replayed iteration latencies in nanoseconds. */
+    long slowest;                   /**< Index of the slowest recorded step. */
+    double slowestReplayed;         /**< Replayed latency of that step in nanoseconds. */
+};
+
+/**
+ * Re-drive the solver through the recording read by \a log: each target
+ * restarts from its recorded angles, each step is run, timed and compared
+ * with the recorded angles.
+ */
+ReplayReport runReplay(SessionReader & log);
+
+/** Write \a report to \a os as text or, if \a json is true, as a JSON object. */
+void printReplay(std::ostream & os, const ReplayReport & report, bool json);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef IKBATCH_H
+#define IKBATCH_H
+
+/** \file ikbatch.h
+ *  Batched inverse kinematics for many identical planar arms.
+ *
+ *  A ChainBatch stores the joint angles of every arm structure-of-arrays
+ *  style: all arms' angles for joint 0, then all arms' angles for joint 1,
+ *  and so on.  solveBatch() applies the same pseudo-inverse update as
+ *  IKChain::solveStep() to several arms at once using the SIMD lanes
+ *  described in iksimd.h.
+ */
+
+#include <vector>
+
+class ChainBatch
+{
+public:
+    /**
+     * Construct a batch of identical arms.
+     * \param lengths is an array of \a links link lengths, base first.
+     * \param links is the number of links in each arm.
+     * \param arms is the number of arms.
+     * \param initialAngle is the starting value of every joint angle.
+     */
+    ChainBatch(const double lengths[], int links, int arms, double initialAngle = 0);
+
+    /** Return the number of links in each arm. */
+    int links() const { return n; }
+
+    /** Return the number of arms. */
+    int arms() const { return count; }
+
+    /** Return the angle of joint \a joint of arm \a arm. */
+    double angle(int arm, int joint) const { return angles[joint * stride + arm]; }
+
+    /** Set the angle of joint \a joint of arm \a arm. */
+    void setAngle(int arm, int joint, double a) { angles[joint * stride + arm] = a; }
+
+    /** Compute the tip position of arm \a arm. */
+    void tip(int arm, double & x, double & y) const;
+
+    /** Return the sum of the link lengths. */
+    double reach() const;
+
+private:
+    friend int solveBatch(ChainBatch & batch, const double tX[], const double tY[],
+                          int steps, double step, double tolerance);
+
+    int n;
+    int count;
+    int stride;
+    std::vector<double> lengths;
+    std::vector<double> angles;
+    std::vector<double> oldDelta;
+
+    // Per-tile scratch, reused by every call to solveBatch()
+    std::vector<double> targetX;
+    std::vector<double> targetY;
+    std::vector<double> sines;
+    std::vector<double> cosines;
+    std::vector<double> jx;
+    std::vector<double> jy;
+    std::vector<double> distance;
+};
+
+/**
+ * Advance every arm of \a batch towards its own target for up to \a steps
+ * updates.  Each update is the one performed by idle(): the tip is moved
+ * \a step units towards the target through the Jacobian pseudo-inverse,
+ * and the previous increments are repeated if J J^T is singular.  An arm
+ * stops moving once its tip is within \a tolerance of its target.
+ * \param tX is an array holding the x coordinate of each arm's target.
+ * \param tY is an array holding the y coordinate of each arm's target.
+ * \return the number of arms within \a tolerance of their targets.
+ */
+int solveBatch(ChainBatch & batch, const double tX[], const double tY[],
+               int steps, double step = 0.01, double tolerance = 0.1);
+
+#endif
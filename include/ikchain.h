@@ -0,0 +1,200 @@
+#ifndef IKCHAIN_H
+#define IKCHAIN_H
+
+/** \file ikchain.h
+ *  Planar inverse kinematics for a serial chain with any number of links.
+ *
+ *  Joint \a i rotates link \a i relative to link \a i-1, so the direction of
+ *  link \a i is the sum of the first \a i+1 joint angles.  All per-link data
+ *  is held in contiguous arrays that are allocated once by the constructor;
+ *  forward() and solveStep() do not allocate.
+ *
+ *  forward() keeps a cache of the cumulative angles and their sines and
+ *  cosines.  Changing joint \a i leaves the cache valid for the links before
+ *  it, so only the links from the first changed joint onwards are evaluated
+ *  again, and their sines and cosines are computed in SIMD groups.
+ */
+
+#include <algorithm>
+#include <vector>
+
+class TaskPool;
+
+/** Ways of turning a task-space step into joint increments. */
+enum IKMethod
+{
+    PSEUDO_INVERSE,         /**< J^T (J J^T)^-1, repeating the last increments at a singularity. */
+    DAMPED_LEAST_SQUARES,   /**< J^T (J J^T + lambda^2 I)^-1 with adaptive lambda. */
+    SVD                     /**< Damped pseudo-inverse built from the SVD of J, with adaptive lambda. */
+};
+
+/** Short names of the IK methods ("pinv", "dls", "svd") in IKMethod order, terminated by a null pointer. */
+extern const char *methodNames[];
+
+class IKChain
+{
+public:
+    /**
+     * Construct a chain from an array of link lengths.
+     * \param lengths is an array of \a n link lengths, base first.
+     * \param n is the number of links.
+     * \param initialAngle is the starting value of every joint angle.
+     */
+    IKChain(const double lengths[], int n, double initialAngle = 0);
+
+    /** Construct a chain from a vector of link lengths, base first. */
+    explicit IKChain(const std::vector<double> & lengths, double initialAngle = 0);
+
+    /** Return the number of links (and joints) in the chain. */
+    int size() const { return n; }
+
+    /** Return the length of link \a i. */
+    double length(int i) const { return lengths[i]; }
+
+    /** Return the angle of joint \a i. */
+    double angle(int i) const { return angles[i]; }
+
+    /**
+     * Set the angle of joint \a i, clamped to the joint's limits.  Call
+     * forward() before using the tip or Jacobian.
+     */
+    void setAngle(int i, double a)
+    {
+        angles[i] = std::min(std::max(a, lower[i]), upper[i]);
+        firstChanged = std::min(firstChanged, i);
+    }
+
+    /**
+     * Limit joint \a i to [lo, hi].  The current angle is clamped.  Joints
+     * are unlimited until this is called; pass -HUGE_VAL and HUGE_VAL to
+     * remove the limits again.
+     */
+    void setLimits(int i, double lo, double hi);
+
+    /** Return the lower limit of joint \a i. */
+    double lowerLimit(int i) const { return lower[i]; }
+
+    /** Return the upper limit of joint \a i. */
+    double upperLimit(int i) const { return upper[i]; }
+
+    /**
+     * Set the gain of the secondary objective, which moves each limited
+     * joint towards the middle of its range.  Each step moves joint i by
+     * -gain (a_i - mid_i) projected onto the null space of J, so the tip
+     * motion is unchanged to first order.  The default is 0, which
+     * disables the objective.
+     */
+    void setNullSpaceGain(double gain) { nullGain = gain; }
+
+    /** Return the gain set by setNullSpaceGain(). */
+    double nullSpaceGain() const { return nullGain; }
+
+    /** Return the joint angles as a contiguous array. */
+    const double *jointAngles() const { return &angles[0]; }
+
+    /** Return the sum of the link lengths, i.e. the radius of the workspace. */
+    double reach() const;
+
+    /**
+     * Compute the tip position and the 2 x n Jacobian for the current angles.
+     * The cumulative angles are evaluated once and shared by both, and only
+     * from the first joint changed since the last forward().
+     */
+    void forward();
+
+    /**
+     * As forward(), but spread over the workers of \a pool for very long
+     * chains.  The cumulative angles and the joint positions are parallel
+     * prefix sums: each block of links is scanned locally, the block totals
+     * are scanned serially, and the totals are added back, so the result
+     * matches forward() to rounding.  Every link is evaluated.
+     */
+    void forward(TaskPool & pool);
+
+    /** Return the x coordinate of the tip computed by the last forward(). */
+    double tipX() const { return x; }
+
+    /** Return the y coordinate of the tip computed by the last forward(). */
+    double tipY() const { return y; }
+
+    /**
+     * Return the x coordinate of the base of link \a i computed by the last
+     * forward().  Joint 0 is at the origin and jointX(size()) is tipX().
+     */
+    double jointX(int i) const { return px[i]; }
+
+    /** Return the y coordinate of the base of link \a i computed by the last forward(). */
+    double jointY(int i) const { return py[i]; }
+
+    /** Return the direction of link \a i, the sum of joint angles 0 to \a i, from the last forward(). */
+    double linkAngle(int i) const { return theta[i]; }
+
+    /** Return the partial derivative of the tip x coordinate with respect to joint \a i. */
+    double dxda(int i) const { return jx[i]; }
+
+    /** Return the partial derivative of the tip y coordinate with respect to joint \a i. */
+    double dyda(int i) const { return jy[i]; }
+
+    /** Select the method used by solveStep().  The default is PSEUDO_INVERSE. */
+    void setMethod(IKMethod m) { ikMethod = m; }
+
+    /** Return the method used by solveStep(). */
+    IKMethod method() const { return ikMethod; }
+
+    /**
+     * Set the adaptive damping used by DAMPED_LEAST_SQUARES and SVD.
+     * No damping is applied while the smallest singular value s of J is at
+     * least \a threshold; below it lambda^2 = (1 - (s/threshold)^2) maxLambda^2.
+     * The defaults are 2% and 1% of reach().
+     */
+    void setDamping(double threshold, double maxLambda);
+
+    /** Return the damping factor used by the last solveStep(). */
+    double damping() const { return lambda; }
+
+    /**
+     * Move the joints so that the tip moves by (dx, dy), to first order,
+     * using the Jacobian from the last forward() and the current method().
+     * With PSEUDO_INVERSE, if J J^T is singular the previous increments are
+     * applied again.  The damped methods are defined at singularities.
+     * The null-space term of setNullSpaceGain() is projected with the same
+     * factorisation of J, and the new angles are clamped to their limits.
+     * \return false if J J^T was singular and the previous increments were used.
+     */
+    bool solveStep(double dx, double dy);
+
+private:
+    void allocate();
+    double adaptiveDamping(double sigmaMin) const;
+    double centring(int i) const;
+    void applyDelta();
+
+    int n;
+    double x;
+    double y;
+    IKMethod ikMethod;
+    double dampingThreshold;
+    double maxDamping;
+    double lambda;
+    double nullGain;
+    bool limited;                       // whether any joint has a finite limit
+    int firstChanged;                   // first joint whose cached link angle is stale
+    std::vector<double> lengths;
+    std::vector<double> angles;
+    std::vector<double> theta;
+    std::vector<double> sines;
+    std::vector<double> cosines;
+    std::vector<double> px;
+    std::vector<double> py;
+    std::vector<double> jx;
+    std::vector<double> jy;
+    std::vector<double> oldDelta;
+    std::vector<double> lower;
+    std::vector<double> upper;
+    std::vector<double> nullStep;
+    std::vector<double> blockTotals;    // per-block scan totals for forward(TaskPool &)
+    std::vector<double> jacobian;
+    std::vector<double> svdWork;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef IKCHAIN3D_H
+#define IKCHAIN3D_H
+
+/** \file ikchain3d.h
+ *  Inverse kinematics in three dimensions for a serial chain of hinge joints.
+ *
+ *  Joint \a i turns about its own axis, given in the frame of link \a i-1,
+ *  and link \a i is the offset from joint \a i to joint \a i+1 in the frame
+ *  of link \a i.  The base joint is at the origin.  A ball joint is three
+ *  hinges with orthogonal axes and zero offsets between them.
+ *
+ *  forward() composes the joint rotations as cugl::Quaternion products and
+ *  builds the 6 x n Jacobian in O(n): column \a i is a_i x (tip - p_i)
+ *  over a_i, where a_i is the world axis and p_i the world position of
+ *  joint \a i.  Steps solve (J J^T + lambda^2 I) w = e by Cholesky
+ *  factorisation; the system is 6 x 6 or 3 x 3 whatever the length of the
+ *  chain.  As in IKChain, the arrays are allocated by the constructor and
+ *  forward() and solveStep() do not allocate.
+ */
+
+#include <vector>
+#include "cugl.h"
+
+class IKChain3D
+{
+public:
+    /**
+     * Construct a chain of \a n hinge joints.
+     * \param axes are the joint axes, each in the frame of the previous link.  They need not be unit vectors.
+     * \param offsets are the links, each in the frame of its own joint.
+     * \param n is the number of joints.
+     */
+    IKChain3D(const cugl::Vector axes[], const cugl::Vector offsets[], int n);
+
+    /** Return the number of joints. */
+    int size() const { return n; }
+
+    /** Return the angle of joint \a i. */
+    double angle(int i) const { return angles[i]; }
+
+    /** Set the angle of joint \a i.  Call forward() before using the tip or Jacobian. */
+    void setAngle(int i, double a) { angles[i] = a; }
+
+    /** Return the sum of the link lengths. */
+    double reach() const;
+
+    /** Compute the joint frames, the tip pose and the 6 x n Jacobian for the current angles. */
+    void forward();
+
+    /** Return the tip position computed by the last forward(). */
+    const cugl::Vector & tip() const { return tipPosition; }
+
+    /**
+     * Return the orientation of the last link computed by the last forward().
+     * Its apply() takes vectors in the frame of the last link to world coordinates.
+     */
+    const cugl::Quaternion & tipOrientation() const { return tipRotation; }
+
+    /** Return the world position of joint \a i computed by the last forward(). */
+    const cugl::Vector & jointPosition(int i) const { return position[i]; }
+
+    /** Return the world axis of joint \a i computed by the last forward(). */
+    const cugl::Vector & jointAxis(int i) const { return worldAxes[i]; }
+
+    /**
+     * Return element (\a row, \a i) of the Jacobian computed by the last
+     * forward().  Rows 0-2 are the tip velocity and rows 3-5 its angular
+     * velocity per unit rate of joint \a i.
+     */
+    double jacobian(int row, int i) const { return jac[row * n + i]; }
+
+    /** Set the damping factor lambda.  The default is 0.3% of reach(). */
+    void setDamping(double lambda) { damping = lambda; }
+
+    /**
+     * Set the largest move (\a step) and turn (\a turn, in radians) that
+     * solve() asks of one step.  The defaults are 10% of reach() and 0.5.
+     */
+    void setStepLimits(double step, double turn);
+
+    /**
+     * Move the joints so that the tip moves by \a dp and turns by the
+     * rotation vector \a dr, to first order, using the Jacobian from the
+     * last forward().
+     * \return false if J J^T + lambda^2 I could not be factored, in which
+     * case the previous increments were applied again.
+     */
+    bool solveStep(const cugl::Vector & dp, const cugl::Vector & dr);
+
+    /** As solveStep(dp, dr), but with the tip orientation left free. */
+    bool solveStep(const cugl::Vector & dp);
+
+    /**
+     * Iterate until the tip is within \a tolerance of \a target and within
+     * \a angleTolerance radians of \a orientation, in the sense of
+     * tipOrientation(), or \a maxIterations
+     * steps have been made.  forward() is up to date on return.
+     * \return the number of steps made.
+     */
+    int solve(const cugl::Vector & target, const cugl::Quaternion & orientation,
+              double tolerance, double angleTolerance, int maxIterations);
+
+    /** As solve() above, but for the tip position alone. */
+    int solve(const cugl::Vector & target, double tolerance, int maxIterations);
+
+private:
+    bool step(const double e[], int m);
+
+    int n;
+    double damping;
+    double maxStep;
+    double maxTurn;
+    cugl::Vector tipPosition;
+    cugl::Quaternion tipRotation;
+    std::vector<cugl::Vector> axes;
+    std::vector<cugl::Vector> offsets;
+    std::vector<double> angles;
+    std::vector<double> halfAngles;
+    std::vector<double> sines;
+    std::vector<double> cosines;
+    std::vector<cugl::Vector> position;
+    std::vector<cugl::Vector> worldAxes;
+    std::vector<double> jac;
+    std::vector<double> oldDelta;
+};
+
+/**
+ * Return the rotation vector of the unit quaternion \a q: the axis of the
+ * rotation that q.apply() performs, scaled by its angle, taking the shorter
+ * way round.
+ */
+cugl::Vector rotationVector(const cugl::Quaternion & q);
+
+#endif
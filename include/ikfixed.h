@@ -0,0 +1,211 @@
+#ifndef IKFIXED_H
+#define IKFIXED_H
+
+/** \file ikfixed.h
+ *  Planar IK for a chain whose length is known at compile time.
+ *
+ *  FixedIKChain<N, Real> performs the same forward() and pseudo-inverse
+ *  solveStep() as IKChain, but the joint count and scalar type are template
+ *  parameters.  Every loop over the joints is expanded by Unroll, so for
+ *  small N the compiler sees straight-line code with all array indices
+ *  constant and can keep the whole chain in registers.  forward() takes
+ *  the link angles' sines and cosines in one vectorised sinCos() call, as
+ *  IKChain does, so Fixed<N, double> stays ahead of IKChain through the
+ *  16 links IK_BENCH measures.  Longer chains should use the run-time
+ *  sized IKChain instead; unrolling 40 joints only bloats the code.
+ *
+ *  The name differs from IKChain because a class and a template cannot
+ *  share a name.
+ */
+
+#include <cmath>
+#include "iksimd.h"
+
+/** Call f(I), f(I+1), ..., f(N-1) with compile-time constant arguments. */
+template <int I, int N>
+struct Unroll
+{
+    template <class F>
+    static void run(F & f)
+    {
+        f(I);
+        Unroll<I + 1, N>::run(f);
+    }
+};
+
+template <int N>
+struct Unroll<N, N>
+{
+    template <class F>
+    static void run(F &) {}
+};
+
+template <int N, class Real = double>
+class FixedIKChain
+{
+public:
+    /** The number of links. */
+    static const int links = N;
+
+    /** Construct a chain from \a N link lengths, base first. */
+    explicit FixedIKChain(const Real lengths[], Real initialAngle = 0) : x(0), y(0)
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            len[i] = lengths[i];
+            angles[i] = initialAngle;
+            jx[i] = jy[i] = oldDelta[i] = 0;
+        }
+    }
+
+    int size() const { return N; }
+    Real length(int i) const { return len[i]; }
+    Real angle(int i) const { return angles[i]; }
+    void setAngle(int i, Real a) { angles[i] = a; }
+    Real tipX() const { return x; }
+    Real tipY() const { return y; }
+    Real dxda(int i) const { return jx[i]; }
+    Real dyda(int i) const { return jy[i]; }
+
+    Real reach() const
+    {
+        Real sum = 0;
+        for (int i = 0; i < N; ++i)
+            sum += len[i];
+        return sum;
+    }
+
+    /** Compute the tip position and the 2 x N Jacobian, as IKChain::forward(). */
+    void forward()
+    {
+        // Absolute link angles, then all their sines and cosines at once as IKChain does
+        Real theta[N], sines[N], cosines[N];
+        Theta t = { angles, theta, 0 };
+        Unroll<0, N>::run(t);
+        sinCosAll(theta, sines, cosines);
+        Forward f = { *this, sines, cosines };
+        x = 0;
+        y = 0;
+        Unroll<0, N>::run(f);
+        Suffix s = { *this };
+        Unroll<1, N>::run(s);
+    }
+
+    /**
+     * Pseudo-inverse step, as IKChain::solveStep() with PSEUDO_INVERSE.
+     * \return false if J J^T was singular and the previous increments were used.
+     */
+    bool solveStep(Real dx, Real dy)
+    {
+        Gram g = { *this, 0, 0, 0 };
+        Unroll<0, N>::run(g);
+        Real det = g.a * g.d - g.b * g.b;
+        if (det == 0)
+        {
+            Repeat r = { *this };
+            Unroll<0, N>::run(r);
+            return false;
+        }
+        Update u = { *this, (g.d * dx - g.b * dy) / det, (g.a * dy - g.b * dx) / det };
+        Unroll<0, N>::run(u);
+        return true;
+    }
+
+private:
+    // Loop bodies for Unroll; each is called with a constant joint index
+
+    struct Theta
+    {
+        const Real *angles;
+        Real *theta;
+        Real sum;
+        void operator()(int i)
+        {
+            sum += angles[i];
+            theta[i] = sum;
+        }
+    };
+
+    // Doubles use the vectorised sinCos() of iksimd.h; floats keep the
+    // single-precision library calls, which beat converting to double
+    static void sinCosAll(const double (&theta)[N], double (&s)[N], double (&c)[N])
+    {
+        sinCos(theta, s, c, N);
+    }
+
+    static void sinCosAll(const float (&theta)[N], float (&s)[N], float (&c)[N])
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            s[i] = std::sin(theta[i]);
+            c[i] = std::cos(theta[i]);
+        }
+    }
+
+    struct Forward
+    {
+        FixedIKChain & c;
+        const Real *sines;
+        const Real *cosines;
+        void operator()(int i)
+        {
+            Real lc = c.len[i] * cosines[i];
+            Real ls = c.len[i] * sines[i];
+            c.x += lc;
+            c.y += ls;
+            c.jx[i] = -ls;
+            c.jy[i] = lc;
+        }
+    };
+
+    struct Suffix
+    {
+        FixedIKChain & c;
+        void operator()(int k)
+        {
+            int i = N - 1 - k;
+            c.jx[i] += c.jx[i + 1];
+            c.jy[i] += c.jy[i + 1];
+        }
+    };
+
+    struct Gram
+    {
+        FixedIKChain & c;
+        Real a, b, d;
+        void operator()(int i)
+        {
+            a += c.jx[i] * c.jx[i];
+            b += c.jx[i] * c.jy[i];
+            d += c.jy[i] * c.jy[i];
+        }
+    };
+
+    struct Repeat
+    {
+        FixedIKChain & c;
+        void operator()(int i) { c.angles[i] += c.oldDelta[i]; }
+    };
+
+    struct Update
+    {
+        FixedIKChain & c;
+        Real wx, wy;
+        void operator()(int i)
+        {
+            Real delta = c.jx[i] * wx + c.jy[i] * wy;
+            c.oldDelta[i] = delta;
+            c.angles[i] += delta;
+        }
+    };
+
+    Real x;
+    Real y;
+    Real len[N];
+    Real angles[N];
+    Real jx[N];
+    Real jy[N];
+    Real oldDelta[N];
+};
+
+#endif
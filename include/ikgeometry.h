@@ -0,0 +1,120 @@
+#ifndef IKGEOMETRY_H
+#define IKGEOMETRY_H
+
+/** \file ikgeometry.h
+ *  Tessellated meshes built once and drawn at any size.
+ *
+ *  Each mesh is a unit shape, tessellated with a given number of slices
+ *  and stacks and compiled into a display list the first time it is
+ *  asked for.  A cylinder of radius 1 runs from z = 0 to z = 1 and a
+ *  sphere of radius 1 is centred at the origin.  Drawing scales the unit
+ *  shape, so a scene of many links holds one mesh per (shape, slices,
+ *  stacks) rather than one per link.
+ *
+ *  Shapes can also be drawn at a level of detail rather than a given
+ *  tessellation.  selectDetail() picks the level for a shape's projected
+ *  radius in pixels, see projectedRadius().  It keeps the current level
+ *  until the radius is a margin past a threshold, so a shape near a
+ *  threshold does not switch back and forth.  Cylinders have a single
+ *  stack at every level; under a directional light more stacks do not
+ *  change the shading along their length.
+ *
+ *  Non-uniform scaling changes the lengths of normals, so GL_NORMALIZE
+ *  should be enabled when lighting is on.  A cache must be used, and
+ *  destroyed, while its GL context is current, and a mesh must not be
+ *  built while another display list is being compiled: prepare() builds
+ *  every level up front.
+ */
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+#include <map>
+
+/** Shapes held by a GeometryCache. */
+enum GeometryShape { CYLINDER, SPHERE };
+
+/** A tessellation used for shapes whose projected radius is at least minPixels. */
+struct DetailLevel
+{
+    int slices;
+    int stacks;                     /**< Stacks of a sphere; cylinders have one. */
+    double minPixels;
+};
+
+/** The levels of detail, coarsest first. */
+const int numDetailLevels = 4;
+extern const DetailLevel detailLevels[numDetailLevels];
+
+/**
+ * Return the level of detail for a shape of projected radius \a pixels
+ * that was last drawn at level \a current, or -1 if it has not been
+ * drawn.  A change of level needs the radius to pass the threshold by
+ * the fraction \a hysteresis.
+ */
+int selectDetail(double pixels, int current, double hysteresis = 0.2);
+
+/**
+ * Return the radius in pixels of a sphere of the given radius at distance
+ * \a depth in front of a perspective camera with vertical field of view
+ * \a fovy degrees and a viewport \a height pixels high.
+ */
+double projectedRadius(double radius, double depth, double fovy, int height);
+
+class GeometryCache
+{
+public:
+    GeometryCache();
+    ~GeometryCache();
+
+    /** Return the display list of the unit \a shape with the given tessellation, building it if needed. */
+    GLuint mesh(GeometryShape shape, int slices, int stacks);
+
+    /** Draw a cylinder of the given radius along z from 0 to \a length. */
+    void cylinder(double radius, double length, int slices, int stacks);
+
+    /** Draw a sphere of the given radius centred at the origin. */
+    void sphere(double radius, int slices, int stacks);
+
+    /** Build the meshes of every level of detail, so that changing level does not stall a frame. */
+    void prepare();
+
+    /** Draw a cylinder of the given radius along z from 0 to \a length, at level of detail \a level. */
+    void cylinder(double radius, double length, int level);
+
+    /** Draw a sphere of the given radius centred at the origin, at level of detail \a level. */
+    void sphere(double radius, int level);
+
+    /** Return the number of triangles in \a shape at level of detail \a level. */
+    static int triangles(GeometryShape shape, int level);
+
+    /** Return the number of meshes built. */
+    int meshes() const { return int(lists.size()); }
+
+private:
+    GeometryCache(const GeometryCache &);
+    GeometryCache & operator=(const GeometryCache &);
+
+    struct Key
+    {
+        GeometryShape shape;
+        int slices, stacks;
+        bool operator<(const Key & k) const
+        {
+            return shape != k.shape ? shape < k.shape : slices != k.slices ? slices < k.slices : stacks < k.stacks;
+        }
+    };
+
+    std::map<Key, GLuint> lists;
+    GLUquadricObj *quadric;
+};
+
+#endif
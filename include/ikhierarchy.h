@@ -0,0 +1,94 @@
+#ifndef IKHIERARCHY_H
+#define IKHIERARCHY_H
+
+/** \file ikhierarchy.h
+ *  A flat hierarchy of links with world transforms computed in one pass.
+ *
+ *  Links are stored in topological order: every link's parent has a lower
+ *  index, so a single forward sweep over the arrays computes each world
+ *  transform from its parent's, with no recursion and no pointers to
+ *  follow.  Per-link data is held in separate contiguous arrays (parent
+ *  index, local angle, length) and the world transforms in one array of
+ *  column-major 4 x 4 matrices that can be passed to glMultMatrixd().
+ *
+ *  Only what moved is recomputed.  setAngle() marks a link dirty when its
+ *  angle changes, and update() recomputes the subtrees below the dirty
+ *  links: by walking each subtree through its child links or, when a root
+ *  has moved and most of the hierarchy follows, by the forward sweep from
+ *  the first dirty link.  updatedLinks() lists the links recomputed by the
+ *  last update(), for callers that cache anything built from the
+ *  transforms.
+ *
+ *  The geometry is that of the demo's links: link i turns by its angle
+ *  about the x axis of its parent's end frame and extends along its own
+ *  z axis.  world(i) is the frame at the base of link i; the base of the
+ *  root is the origin.
+ */
+
+#include <vector>
+
+class LinkHierarchy
+{
+public:
+    /** Construct an empty hierarchy. */
+    LinkHierarchy() {}
+
+    /**
+     * Add a link of the given length, attached to the end of link
+     * \a parent, or to the origin if \a parent is -1.
+     * \pre parent < size(), so links are added in topological order.
+     * \return the index of the new link.
+     */
+    int add(int parent, double length, double angle = 0);
+
+    /** Return the number of links. */
+    int size() const { return int(parents.size()); }
+
+    /** Return the parent of link \a i, or -1 for a root. */
+    int parent(int i) const { return parents[i]; }
+
+    /** Return the length of link \a i. */
+    double length(int i) const { return lengths[i]; }
+
+    /** Set the angle of link \a i relative to its parent, marking its subtree for update() if it changed. */
+    void setAngle(int i, double a)
+    {
+        if (a == angles[i])
+            return;
+        angles[i] = a;
+        if (!dirty[i])
+        {
+            dirty[i] = 1;
+            pending.push_back(i);
+        }
+    }
+
+    /** Return the angle of link \a i relative to its parent. */
+    double angle(int i) const { return angles[i]; }
+
+    /** Recompute the world transforms of the links whose angle, or an ancestor's, changed. */
+    void update();
+
+    /** Return the links whose world transforms the last update() recomputed, each after its parent. */
+    const std::vector<int> & updatedLinks() const { return touched; }
+
+    /** Return the world transform of the base of link \a i, column-major, as computed by the last update(). */
+    const double *world(int i) const { return &worlds[16 * i]; }
+
+private:
+    void place(int i);
+
+    std::vector<int> parents;
+    std::vector<int> firstChild;    // -1 for a leaf
+    std::vector<int> lastChild;
+    std::vector<int> nextSibling;   // -1 for the last child
+    std::vector<double> lengths;
+    std::vector<double> angles;
+    std::vector<double> worlds;
+    std::vector<unsigned char> dirty;
+    std::vector<int> pending;       // links made dirty since the last update()
+    std::vector<int> touched;
+    std::vector<int> stack;
+};
+
+#endif
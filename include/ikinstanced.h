@@ -0,0 +1,107 @@
+#ifndef IKINSTANCED_H
+#define IKINSTANCED_H
+
+/** \file ikinstanced.h
+ *  Draw crowds of links with OpenGL 3.3 core-profile instancing.
+ *
+ *  The fixed-function path issues a display list per link.  This renderer
+ *  collects one instance per shape per frame instead: a rigid world
+ *  transform, a scale applied before it and a colour.  draw() uploads
+ *  them to an instance buffer per shape and draws every cylinder with one
+ *  instanced call and every sphere with another, so a frame takes two
+ *  draw calls however many arms there are.
+ *
+ *  The unit meshes of every level of detail in ikgeometry.h are built
+ *  once into a vertex and an index buffer per shape.  A frame draws all
+ *  its instances at one level.  Lighting follows the fixed-function
+ *  path: one directional light, the material's colour for ambient and
+ *  diffuse, and a white highlight of shininess 50.
+ *
+ *  Entry points are loaded with GLEW.  initialize() needs a current
+ *  context of version 3.3 or later, and all other calls need the same
+ *  context.  Mesa's llvmpipe software renderer provides one, so the
+ *  renderer also runs without a GPU.
+ */
+
+#include <string>
+#include <vector>
+#include "ikgeometry.h"
+
+class InstancedRenderer
+{
+public:
+    InstancedRenderer();
+    ~InstancedRenderer();
+
+    /**
+     * Load the GL entry points, compile the shaders and build the meshes.
+     * \return false, with the reason in error(), if the context cannot
+     * run the renderer.
+     */
+    bool initialize();
+
+    /** Return why initialize() failed. */
+    const std::string & error() const { return failure; }
+
+    /** Forget the instances of the previous frame. */
+    void clear();
+
+    /**
+     * Add an instance of \a shape, scaled by (sx, sy, sz) and then placed
+     * by the rigid column-major transform \a world, in the RGBA \a colour.
+     */
+    void add(GeometryShape shape, const double *world, double sx, double sy, double sz, const float *colour);
+
+    /**
+     * Draw the instances at level of detail \a level, with column-major
+     * \a projection and \a view matrices and a directional light towards
+     * eye-space direction \a light.
+     */
+    void draw(const float *projection, const float *view, const float *light, int level);
+
+    /** Return the number of instances added since clear(). */
+    long instances() const { return long(cylinders.size() + spheres.size()) / floatsPerInstance; }
+
+    /** Return the draw calls of the last draw(). */
+    int drawCalls() const { return calls; }
+
+    /** Return the triangles of the last draw(). */
+    long triangles() const { return drawn; }
+
+private:
+    InstancedRenderer(const InstancedRenderer &);
+    InstancedRenderer & operator=(const InstancedRenderer &);
+
+    static const int floatsPerInstance = 24;    // world matrix, scale, colour
+
+    // The buffers of one shape, with the index range of each level in them
+    struct Mesh
+    {
+        unsigned int vertexArray;
+        unsigned int vertices;
+        unsigned int indices;
+        unsigned int instances;
+        int first[numDetailLevels];
+        int count[numDetailLevels];
+    };
+
+    void build(Mesh & mesh, GeometryShape shape);
+    void drawMesh(Mesh & mesh, const std::vector<float> & data, GeometryShape shape, int level);
+
+    std::string failure;
+    unsigned int program;
+    int projectionLocation, viewLocation, lightLocation;
+    Mesh meshes[2];
+    std::vector<float> cylinders;
+    std::vector<float> spheres;
+    int calls;
+    long drawn;
+};
+
+/** Set \a m to a column-major perspective projection, as gluPerspective() would multiply by. */
+void perspectiveMatrix(float *m, double fovy, double aspect, double zNear, double zFar);
+
+/** Set \a m to a column-major view matrix from \a eye looking at \a centre, as gluLookAt() would multiply by. */
+void lookAtMatrix(float *m, const double *eye, const double *centre, const double *up);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef IKLINALG_H
+#define IKLINALG_H
+
+/** \file iklinalg.h
+ *  Small dense linear algebra used by the IK solvers.
+ *
+ *  Matrices are row-major arrays of doubles.  The functions do not allocate:
+ *  callers pass a scratch array of the size given by the matching
+ *  \c ...WorkSize() function, so a solver can size it once.
+ */
+
+/** Return the number of doubles of scratch needed by svdDecompose() for an \a m x \a n matrix. */
+int svdWorkSize(int m, int n);
+
+/**
+ * Compute the singular value decomposition of \a a by one-sided Jacobi
+ * rotations on its smaller dimension.  The factors are left in \a work for
+ * svdSolve().
+ * \param a is the \a m x \a n matrix.
+ * \param work is scratch of at least svdWorkSize(m, n) doubles.
+ * \param sigma receives the min(m, n) singular values, in no particular order.
+ */
+void svdDecompose(const double a[], int m, int n, double work[], double sigma[]);
+
+/**
+ * Solve \a a \a x = \a e in the damped least-squares sense from the
+ * decomposition computed by svdDecompose().  The solution is
+ * x = sum_k v_k (s_k / (s_k^2 + lambda^2)) (u_k . e), which is the
+ * Moore-Penrose pseudo-inverse when \a lambda is zero.  Singular values
+ * smaller than 1e-10 of the largest are treated as zero.
+ * \param e is the right hand side, of length \a m.
+ * \param lambda is the damping factor.
+ * \param x receives the solution, of length \a n.
+ * \return the number of singular values treated as non-zero.
+ */
+int svdSolve(int m, int n, const double work[], const double sigma[],
+             const double e[], double lambda, double x[]);
+
+/**
+ * Factor the symmetric positive definite \a n x \a n matrix \a a as L L^T
+ * in place.  Only the lower triangle of \a a is read, and L overwrites it.
+ * \return false if \a a is not positive definite, in which case \a a is
+ * partly overwritten.
+ */
+bool choleskyDecompose(double a[], int n);
+
+/**
+ * Solve L L^T \a x = \a b, where L was computed by choleskyDecompose().
+ * \a x may be the same array as \a b.
+ */
+void choleskySolve(const double l[], int n, const double b[], double x[]);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef IKRANDOM_H
+#define IKRANDOM_H
+
+/** \file ikrandom.h
+ *  Seedable random targets for the IK demo, the headless runner and the benchmarks.
+ *
+ *  cugl::randReal() keeps its seed in a function-local static, so runs
+ *  cannot be repeated with a chosen seed.  IKRandom uses the same linear
+ *  congruential generator but keeps the state in the object.
+ */
+
+#include <cmath>
+
+class IKRandom
+{
+public:
+    /** Construct a generator with the given seed. */
+    explicit IKRandom(unsigned int seed = 12345678) : state(seed) {}
+
+    /** Return the current state, which can be passed to the constructor to resume the sequence. */
+    unsigned int seed() const { return state; }
+
+    /** Return a random double in [0, 1). */
+    double real()
+    {
+        state = 1664525 * state + 1013904223;
+        return (state >> 8) / 16777216.0;
+    }
+
+    /**
+     * Choose a random target for an arm of the given reach: a random
+     * direction and a radius in [2, reach - 1].
+     */
+    void target(double reach, double & tX, double & tY)
+    {
+        double ang = 8 * atan(1.0) * real();
+        double rad = 2 + (reach - 3) * real();
+        tX = rad * cos(ang);
+        tY = rad * sin(ang);
+    }
+
+private:
+    unsigned int state;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef IKREACH_H
+#define IKREACH_H
+
+/** \file ikreach.h
+ *  A precomputed map of where a chain's tip can go, for screening targets.
+ *
+ *  The map covers [-reach, reach]^2 with resolution x resolution cells.
+ *  It is built by sampling joint space uniformly within the joint limits
+ *  and running forward kinematics on every sample, spread over a
+ *  TaskPool.  A cell is reachable if some sample put the tip in it; its
+ *  dexterity is the fraction of 16 tip directions seen there.  Each
+ *  reachable cell keeps the sampled tip nearest its centre, and each
+ *  unreachable cell the nearest reachable cell, so classifying and
+ *  clamping a target cost one table read.
+ *
+ *  Sampling is conservative: cells at the edge of the workspace that no
+ *  sample hit are treated as unreachable, which also screens out targets
+ *  that the arm can reach only fully stretched.
+ */
+
+#include <vector>
+#include "ikchain.h"
+
+class TaskPool;
+
+class ReachabilityMap
+{
+public:
+    /** Construct an empty map; every target counts as reachable until build(). */
+    ReachabilityMap();
+
+    /**
+     * Sample \a samples configurations of \a chain, within its joint
+     * limits, on the workers of \a pool.  The result depends only on the
+     * chain and the arguments, not on the number of workers.
+     */
+    void build(const IKChain & chain, int resolution, long samples, TaskPool & pool);
+
+    /** Return the number of cells along each side, or 0 for an empty map. */
+    int resolution() const { return res; }
+
+    /** Return the fraction of cells the tip can reach. */
+    double coverage() const;
+
+    /** Return the memory used by the map in bytes. */
+    size_t bytes() const
+    {
+        return directions.size() * sizeof(unsigned short) + points.size() * sizeof(float) + nearest.size() * sizeof(int);
+    }
+
+    /** Return true if the tip can reach the cell containing (x, y). */
+    bool reachable(double x, double y) const;
+
+    /**
+     * Return the fraction, in [0, 1], of tip directions with which the tip
+     * reaches the cell containing (x, y).  Zero means unreachable.
+     */
+    double dexterity(double x, double y) const;
+
+    /**
+     * If (x, y) is not reachable, move it to a sampled tip position in the
+     * nearest reachable cell.  \return true if the target was moved.
+     */
+    bool clamp(double & x, double & y) const;
+
+private:
+    int cell(double x, double y) const;
+
+    int res;
+    double extent;                              // the map covers [-extent, extent]^2
+    std::vector<unsigned short> directions;     // bit k: the tip pointed into sector k
+    std::vector<float> points;                  // sampled tip nearest the centre, x then y
+    std::vector<int> nearest;                   // nearest reachable cell, or -1 if none
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef IKRECORD_H
+#define IKRECORD_H
+
+/** \file ikrecord.h
+ *  Compact binary recordings of IK sessions, for replaying them exactly.
+ *
+ *  A recording starts with the chain: link lengths, joint limits, the
+ *  null-space gain and the seed of the target generator.  Then come
+ *  events in the order they happened:
+ *
+ *  - 'M': the solver and method in use from here on;
+ *  - 'T': a new target, with the joint angles at that moment in full
+ *    precision, after any warm start;
+ *  - 'S': one solver iteration, with its duration in nanoseconds and the
+ *    joint angles after it.
+ *
+ *  Step angles are quantised to a fixed quantum and stored as differences
+ *  from the previous step, zigzag-encoded as variable-length integers, so
+ *  a step of a four-link arm takes about ten bytes.  Targets keep full
+ *  precision so that a replay can restart each target from exactly the
+ *  recorded state.
+ */
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ikchain.h"
+
+/** The chain and settings at the start of a recording. */
+struct SessionHeader
+{
+    unsigned int seed;
+    double quantum;                     /**< Angles in steps are multiples of this, in radians. */
+    std::vector<double> lengths;
+    std::vector<double> lower;
+    std::vector<double> upper;
+    double nullGain;
+};
+
+/** One event of a recording. */
+struct SessionEvent
+{
+    char type;                          /**< 'M', 'T' or 'S'. */
+    std::string solver;                 /**< 'M': name for newSolver(). */
+    int method;                         /**< 'M': an IKMethod. */
+    double x, y;                        /**< 'T': the target. */
+    std::vector<double> angles;         /**< 'T': exact angles; 'S': quantised angles in radians. */
+    std::vector<long long> quantised;   /**< 'S': the angles in quanta. */
+    long nanoseconds;                   /**< 'S': the duration of the iteration. */
+};
+
+class SessionRecorder
+{
+public:
+    /**
+     * Start recording a session of \a chain to \a path.
+     * \param quantum is the resolution of the step angles in radians.
+     */
+    SessionRecorder(const std::string & path, const IKChain & chain, unsigned int seed, double quantum = 1.0 / (1 << 20));
+
+    /** Flush and close the file. */
+    ~SessionRecorder();
+
+    /** Return false if the file could not be written. */
+    bool good() const { return bool(out); }
+
+    /** Record that \a solver and the chain's method are used from now on. */
+    void solver(const std::string & solver, const IKChain & chain);
+
+    /** Record a new target and the chain's angles as it starts towards it. */
+    void target(double x, double y, const IKChain & chain);
+
+    /** Record one iteration that took \a nanoseconds and left the chain's angles as they are. */
+    void step(const IKChain & chain, long nanoseconds);
+
+    /** Return the number of bytes written so far. */
+    long bytes() const { return written + long(buffer.size()); }
+
+private:
+    void flush();
+    void put(const void *data, size_t size);
+    void putVarint(unsigned long long v);
+
+    std::ofstream out;
+    double quantum;
+    std::vector<long long> previous;
+    std::vector<unsigned char> buffer;
+    long written;
+};
+
+class SessionReader
+{
+public:
+    /** Open the recording at \a path and read its header. */
+    explicit SessionReader(const std::string & path);
+
+    /** Return false if the file is missing or its header is malformed. */
+    bool good() const { return ok; }
+
+    /** Return the header of the recording. */
+    const SessionHeader & header() const { return head; }
+
+    /**
+     * Read the next event into \a e.  \return false at the end of the
+     * recording or if the rest of it is malformed; see truncated().
+     */
+    bool next(SessionEvent & e);
+
+    /** Return true if reading stopped at a malformed or partial event. */
+    bool truncated() const { return broken; }
+
+    /** Convert \a angle to quanta, as the recorder does. */
+    long long quantise(double angle) const;
+
+private:
+    bool getVarint(unsigned long long & v);
+
+    std::ifstream in;
+    SessionHeader head;
+    std::vector<long long> previous;
+    bool ok;
+    bool broken;
+};
+
+#endif
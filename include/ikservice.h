@@ -0,0 +1,141 @@
+#ifndef IKSERVICE_H
+#define IKSERVICE_H
+
+/** \file ikservice.h
+ *  A local IK solve service on a Unix domain socket, and its client.
+ *
+ *  Each connection gets its own copy of the chain and its own solver, so
+ *  a client's requests are solved in order, each from the solution of the
+ *  one before.  On connecting the service sends the number of links as an
+ *  int32; after that the client sends requests and the service answers:
+ *
+ *  - request, 24 bytes: int32 id, int32 reserved (0), double x, double y;
+ *  - response, 16 + 8n bytes: int32 id, int32 iterations, double error,
+ *    double angles[n].
+ *
+ *  All fields are in native byte order.  A client may send further
+ *  requests before the answers arrive.
+ *
+ *  One thread runs the event loop.  Each round it reads everything the
+ *  clients have sent, solves all complete requests as one batch, and
+ *  writes the answers without blocking.  The batch is spread over a
+ *  TaskPool, one client per task.  Requests that arrive while a batch is
+ *  being solved go into the next one, so batches grow with the load.
+ *  A client with too many unsent answers is not read from until they
+ *  drain.
+ *
+ *  Unix sockets are not available on _WIN32; there listen() and
+ *  connect() fail.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ikchain.h"
+#include "iktask.h"
+
+/** Settings of the service. */
+struct ServiceOptions
+{
+    ServiceOptions() : threads(0), tolerance(0.1), maxIterations(1000) {}
+
+    int threads;            /**< Workers solving a batch; zero means one per hardware thread. */
+    double tolerance;       /**< Distance at which a target counts as reached. */
+    int maxIterations;      /**< Iterations after which the current angles are returned anyway. */
+};
+
+class IKService
+{
+public:
+    /**
+     * Prepare a service that solves for copies of \a prototype with the
+     * solver named \a solver (see newSolver()).
+     */
+    IKService(const IKChain & prototype, const std::string & solver, const ServiceOptions & options = ServiceOptions());
+
+    /** Close the socket and every connection. */
+    ~IKService();
+
+    /**
+     * Listen on the Unix socket \a path, replacing any file there.
+     * \return false if the socket could not be set up.
+     */
+    bool listen(const std::string & path);
+
+    /** Serve connections until stop() is called. */
+    void run();
+
+    /** Make run() return within a tenth of a second.  Safe to call from a signal handler. */
+    void stop() { stopping = true; }
+
+    /** Return the number of requests answered. */
+    long requests() const { return answered; }
+
+    /** Return the number of batches solved. */
+    long batches() const { return rounds; }
+
+    /** Return the number of requests in the largest batch. */
+    long largestBatch() const { return largest; }
+
+private:
+    struct Connection;
+
+    void accept();
+    bool receive(Connection & c);
+    void send(Connection & c);
+    void solve(Connection & c);
+
+    IKChain prototype;
+    std::string solverName;
+    ServiceOptions options;
+    TaskPool pool;
+    int server;
+    std::string path;
+    std::atomic<bool> stopping;
+    std::vector<std::unique_ptr<Connection> > connections;
+    std::atomic<long> answered;
+    std::atomic<long> rounds;
+    std::atomic<long> largest;
+};
+
+/** One answer from the service. */
+struct IKResponse
+{
+    int id;
+    int iterations;
+    double error;
+    std::vector<double> angles;
+};
+
+class IKClient
+{
+public:
+    IKClient();
+
+    /** Close the connection. */
+    ~IKClient();
+
+    /** Connect to the service on \a path.  \return false if it is not there. */
+    bool connect(const std::string & path);
+
+    /** Return the number of links of the service's chain. */
+    int links() const { return n; }
+
+    /** Send a request for target (x, y).  \return false if the connection is lost. */
+    bool request(int id, double x, double y);
+
+    /** Wait for the next answer.  \return false if the connection is lost. */
+    bool response(IKResponse & r);
+
+    /** Close the connection. */
+    void close();
+
+private:
+    bool readFully(void *data, size_t size);
+
+    int fd;
+    int n;
+};
+
+#endif
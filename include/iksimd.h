@@ -0,0 +1,213 @@
+#ifndef IKSIMD_H
+#define IKSIMD_H
+
+/** \file iksimd.h
+ *  A minimal packed-double type for the batched IK kernels.
+ *
+ *  SimdReal holds \c SimdReal::width doubles: four with AVX, two with SSE2
+ *  and one otherwise.  The instruction set is chosen at compile time from the
+ *  compiler's target flags, so a kernel written with these operators is
+ *  compiled once for the widest set available.  Loads and stores are
+ *  unaligned, so arrays need no special allocation.
+ */
+
+#include <cmath>
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+/** Four packed doubles. */
+struct SimdReal
+{
+    enum { width = 4 };
+    __m256d v;
+    SimdReal() {}
+    SimdReal(__m256d v) : v(v) {}
+    explicit SimdReal(double x) : v(_mm256_set1_pd(x)) {}
+    static SimdReal load(const double *p) { return _mm256_loadu_pd(p); }
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+
+/** Lane mask produced by comparisons. */
+struct SimdMask
+{
+    __m256d m;
+    SimdMask(__m256d m) : m(m) {}
+};
+
+inline SimdReal operator+(SimdReal a, SimdReal b) { return _mm256_add_pd(a.v, b.v); }
+inline SimdReal operator-(SimdReal a, SimdReal b) { return _mm256_sub_pd(a.v, b.v); }
+inline SimdReal operator*(SimdReal a, SimdReal b) { return _mm256_mul_pd(a.v, b.v); }
+inline SimdReal operator/(SimdReal a, SimdReal b) { return _mm256_div_pd(a.v, b.v); }
+inline SimdReal sqrt(SimdReal a) { return _mm256_sqrt_pd(a.v); }
+inline SimdReal min(SimdReal a, SimdReal b) { return _mm256_min_pd(a.v, b.v); }
+inline SimdReal max(SimdReal a, SimdReal b) { return _mm256_max_pd(a.v, b.v); }
+inline SimdMask operator<(SimdReal a, SimdReal b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline SimdMask operator==(SimdReal a, SimdReal b) { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return _mm256_or_pd(a.m, b.m); }
+
+/** Return \a a in lanes where \a m is set and \a b elsewhere. */
+inline SimdReal select(SimdMask m, SimdReal a, SimdReal b) { return _mm256_blendv_pd(b.v, a.v, m.m); }
+inline bool all(SimdMask m) { return _mm256_movemask_pd(m.m) == 0xf; }
+inline int count(SimdMask m) { return __builtin_popcount(_mm256_movemask_pd(m.m)); }
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+/** Two packed doubles. */
+struct SimdReal
+{
+    enum { width = 2 };
+    __m128d v;
+    SimdReal() {}
+    SimdReal(__m128d v) : v(v) {}
+    explicit SimdReal(double x) : v(_mm_set1_pd(x)) {}
+    static SimdReal load(const double *p) { return _mm_loadu_pd(p); }
+    void store(double *p) const { _mm_storeu_pd(p, v); }
+};
+
+/** Lane mask produced by comparisons. */
+struct SimdMask
+{
+    __m128d m;
+    SimdMask(__m128d m) : m(m) {}
+};
+
+inline SimdReal operator+(SimdReal a, SimdReal b) { return _mm_add_pd(a.v, b.v); }
+inline SimdReal operator-(SimdReal a, SimdReal b) { return _mm_sub_pd(a.v, b.v); }
+inline SimdReal operator*(SimdReal a, SimdReal b) { return _mm_mul_pd(a.v, b.v); }
+inline SimdReal operator/(SimdReal a, SimdReal b) { return _mm_div_pd(a.v, b.v); }
+inline SimdReal sqrt(SimdReal a) { return _mm_sqrt_pd(a.v); }
+inline SimdReal min(SimdReal a, SimdReal b) { return _mm_min_pd(a.v, b.v); }
+inline SimdReal max(SimdReal a, SimdReal b) { return _mm_max_pd(a.v, b.v); }
+inline SimdMask operator<(SimdReal a, SimdReal b) { return _mm_cmplt_pd(a.v, b.v); }
+inline SimdMask operator==(SimdReal a, SimdReal b) { return _mm_cmpeq_pd(a.v, b.v); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return _mm_or_pd(a.m, b.m); }
+
+/** Return \a a in lanes where \a m is set and \a b elsewhere. */
+inline SimdReal select(SimdMask m, SimdReal a, SimdReal b)
+{
+    return _mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v));
+}
+inline bool all(SimdMask m) { return _mm_movemask_pd(m.m) == 0x3; }
+inline int count(SimdMask m) { return (_mm_movemask_pd(m.m) & 1) + (_mm_movemask_pd(m.m) >> 1); }
+
+#else
+
+/** Scalar fallback: one lane. */
+struct SimdReal
+{
+    enum { width = 1 };
+    double v;
+    SimdReal() {}
+    explicit SimdReal(double x) : v(x) {}
+    static SimdReal load(const double *p) { return SimdReal(*p); }
+    void store(double *p) const { *p = v; }
+};
+
+/** Lane mask produced by comparisons. */
+struct SimdMask
+{
+    bool m;
+    SimdMask(bool m) : m(m) {}
+};
+
+inline SimdReal operator+(SimdReal a, SimdReal b) { return SimdReal(a.v + b.v); }
+inline SimdReal operator-(SimdReal a, SimdReal b) { return SimdReal(a.v - b.v); }
+inline SimdReal operator*(SimdReal a, SimdReal b) { return SimdReal(a.v * b.v); }
+inline SimdReal operator/(SimdReal a, SimdReal b) { return SimdReal(a.v / b.v); }
+inline SimdReal sqrt(SimdReal a) { return SimdReal(std::sqrt(a.v)); }
+inline SimdReal min(SimdReal a, SimdReal b) { return SimdReal(a.v < b.v ? a.v : b.v); }
+inline SimdReal max(SimdReal a, SimdReal b) { return SimdReal(a.v > b.v ? a.v : b.v); }
+inline SimdMask operator<(SimdReal a, SimdReal b) { return a.v < b.v; }
+inline SimdMask operator==(SimdReal a, SimdReal b) { return a.v == b.v; }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return a.m || b.m; }
+
+/** Return \a a in lanes where \a m is set and \a b elsewhere. */
+inline SimdReal select(SimdMask m, SimdReal a, SimdReal b) { return m.m ? a : b; }
+inline bool all(SimdMask m) { return m.m; }
+inline int count(SimdMask m) { return m.m ? 1 : 0; }
+
+#endif
+
+/**
+ * Compute sin(x) and cos(x) in every lane.  The argument is reduced by the
+ * nearest multiple of pi/2 in three parts, and the fdlibm kernel polynomials
+ * are evaluated on [-pi/4, pi/4].  The result is within a couple of ulps of
+ * std::sin and std::cos for |x| < 1e5.
+ */
+inline void sinCos(SimdReal x, SimdReal & s, SimdReal & c)
+{
+    const SimdReal zero(0.0), one(1.0), two(2.0), four(4.0);
+    const SimdReal magic(6755399441055744.0);   // 1.5 * 2^52: x + magic - magic rounds x to an integer
+                                                // (assumes no x87 excess precision)
+
+    SimdReal q = (x * SimdReal(6.36619772367581382433e-01) + magic) - magic;
+    SimdReal r = x - q * SimdReal(1.57079632673412561417e+00);
+    r = r - q * SimdReal(6.07710050630396597660e-11);
+    r = r - q * SimdReal(2.02226624879595063154e-21);
+
+    SimdReal z = r * r;
+    SimdReal ps = r + r * z * (SimdReal(-1.66666666666666324348e-01) + z * (SimdReal(8.33333333332248946124e-03)
+                + z * (SimdReal(-1.98412698298579493134e-04) + z * (SimdReal(2.75573137070700676789e-06)
+                + z * (SimdReal(-2.50507602534068634195e-08) + z * SimdReal(1.58969099521155010221e-10))))));
+    SimdReal pc = one - SimdReal(0.5) * z + z * z * (SimdReal(4.16666666666666019037e-02)
+                + z * (SimdReal(-1.38888888888741095749e-03) + z * (SimdReal(2.48015872894767294178e-05)
+                + z * (SimdReal(-2.75573143513906633035e-07) + z * (SimdReal(2.08757232129817482790e-09)
+                + z * SimdReal(-1.13596475577881948265e-11))))));
+
+    // Quadrant m = q mod 4 selects and negates the kernels
+    SimdReal m = q - four * ((q * SimdReal(0.25) + magic) - magic);
+    m = select(m < zero, m + four, m);
+    SimdMask odd = (m == one) | (m == SimdReal(3.0));
+    SimdReal sv = select(odd, pc, ps);
+    SimdReal cv = select(odd, ps, pc);
+    s = select(m < two, sv, zero - sv);
+    c = select((m == one) | (m == two), zero - cv, cv);
+}
+
+/**
+ * Compute the sines and cosines of \a n angles.  \a c may be the same array
+ * as \a theta.  Groups containing an angle too large for sinCos() fall back
+ * on std::sin and std::cos.
+ */
+inline void sinCos(const double theta[], double s[], double c[], int n)
+{
+    const int W = SimdReal::width;
+    const SimdReal limit(1e5);
+    int i = 0;
+    for (; i + W <= n; i += W)
+    {
+        SimdReal x = SimdReal::load(theta + i);
+        if (all(max(x, SimdReal(0.0) - x) < limit))
+        {
+            SimdReal vs, vc;
+            sinCos(x, vs, vc);
+            vs.store(s + i);
+            vc.store(c + i);
+        }
+        else
+            for (int k = i; k < i + W; ++k)
+            {
+                double t = theta[k];
+                s[k] = std::sin(t);
+                c[k] = std::cos(t);
+            }
+    }
+    for (; i < n; ++i)
+    {
+        double t = theta[i];
+        s[i] = std::sin(t);
+        c[i] = std::cos(t);
+    }
+}
+
+/** Name of the instruction set the kernels were compiled for. */
+inline const char *simdName()
+{
+    return SimdReal::width == 4 ? "AVX" : SimdReal::width == 2 ? "SSE2" : "scalar";
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef IKSOLVER_H
+#define IKSOLVER_H
+
+/** \file iksolver.h
+ *  Interchangeable IK engines for an IKChain.
+ *
+ *  Every engine implements iterate(), which moves the chain one iteration
+ *  towards a target, so callers such as idle() and the benchmarks can swap
+ *  engines at run time.  An iteration means different amounts of work for
+ *  different engines: the Jacobian engine moves the tip a fixed step, while
+ *  CCD and FABRIK make a full sweep over the chain.
+ */
+
+#include <string>
+#include <vector>
+#include "ikchain.h"
+
+class IKSolver
+{
+public:
+    virtual ~IKSolver() {}
+
+    /** Return a short name for the engine. */
+    virtual const char *name() const = 0;
+
+    /**
+     * Perform one iteration towards (tX, tY).
+     * \pre forward() has been called for the current joint angles.
+     * \return false if the iteration hit a singularity and fell back on the previous increments.
+     */
+    virtual bool iterate(IKChain & chain, double tX, double tY) = 0;
+
+    /**
+     * Iterate until the tip is within \a tolerance of (tX, tY) or
+     * \a maxIterations iterations have been performed.
+     * \return the number of iterations performed.
+     */
+    virtual int solve(IKChain & chain, double tX, double tY, double tolerance, int maxIterations);
+};
+
+/** How JacobianSolver decides how far to move the tip in one iteration. */
+enum StepControl
+{
+    FIXED_STEP,     /**< Move the tip a fixed distance, as idle() always has. */
+    LINE_SEARCH,    /**< Aim for the target and halve the step until the residual drops enough. */
+    TRUST_REGION    /**< Limit the step to a radius that grows or shrinks with the model's accuracy. */
+};
+
+/**
+ * Jacobian engine: move the tip towards the target using the chain's
+ * IKMethod.  With FIXED_STEP this is the update performed by idle(): the
+ * tip moves \a step units per iteration.  The adaptive controls take large
+ * steps far from the target and small ones near it, at the cost of one
+ * extra forward() per trial step.
+ */
+class JacobianSolver : public IKSolver
+{
+public:
+    explicit JacobianSolver(double step = 0.01, StepControl control = FIXED_STEP);
+    const char *name() const;
+    bool iterate(IKChain & chain, double tX, double tY);
+
+    /** Select the step control. */
+    void setStepControl(StepControl c) { control = c; }
+
+    /** Return the step control. */
+    StepControl stepControl() const { return control; }
+
+    /** Return the current trust region radius. */
+    double trustRadius() const { return radius; }
+
+private:
+    void project(IKChain & chain, double dx, double dy);
+
+    double step;
+    StepControl control;
+    double radius;
+    std::vector<double> saved;
+    std::vector<double> direction;
+    std::vector<char> movable;
+};
+
+/**
+ * Cyclic coordinate descent: each joint, from the tip back to the base,
+ * is rotated so that the tip points at the target.
+ */
+class CCDSolver : public IKSolver
+{
+public:
+    const char *name() const { return "ccd"; }
+    bool iterate(IKChain & chain, double tX, double tY);
+};
+
+/**
+ * Forward and backward reaching IK: the joint positions are dragged to the
+ * target and back to the base, keeping link lengths, and the joint angles
+ * are recovered from the new positions.  The passes know nothing of joint
+ * limits, which setAngle() applies afterwards, so on a limited chain many
+ * reachable targets are never reached.
+ */
+class FABRIKSolver : public IKSolver
+{
+public:
+    const char *name() const { return "fabrik"; }
+    bool iterate(IKChain & chain, double tX, double tY);
+
+private:
+    std::vector<double> px;
+    std::vector<double> py;
+};
+
+/** How the last LevenbergMarquardtSolver::solve() went. */
+struct ConvergenceStats
+{
+    int iterations;                 /**< Accepted steps. */
+    int rejected;                   /**< Trial steps that increased the residual and were undone. */
+    bool converged;                 /**< True if the tolerance was met. */
+    double seconds;                 /**< Wall time of the solve. */
+    std::vector<double> residuals;  /**< Distance to the target before each step and after the last. */
+};
+
+/**
+ * Levenberg-Marquardt engine for solving to a tight tolerance offline.
+ * Each iteration solves (J J^T + mu I) w = e for the residual e and moves
+ * the joints by J^T w, using the chain's analytic Jacobian.  The step is
+ * kept only if the residual drops; mu shrinks after good steps, towards
+ * Gauss-Newton and quadratic convergence, and grows after bad ones,
+ * towards a short gradient step.  With gaussNewton set, mu is zero and
+ * every full step is taken, which converges fastest from a good start
+ * and can diverge from a poor one.
+ */
+class LevenbergMarquardtSolver : public IKSolver
+{
+public:
+    explicit LevenbergMarquardtSolver(bool gaussNewton = false);
+    const char *name() const { return gaussNewton ? "gauss-newton" : "lm"; }
+
+    /**
+     * As IKSolver::iterate(); the damping carries over between calls for
+     * the same target.  \return false also if no trial step lowered the
+     * residual, in which case the chain is left as it was.
+     */
+    bool iterate(IKChain & chain, double tX, double tY);
+
+    /** As IKSolver::solve(), and record stats(). */
+    int solve(IKChain & chain, double tX, double tY, double tolerance, int maxIterations);
+
+    /** Return the statistics of the last solve(). */
+    const ConvergenceStats & stats() const { return last; }
+
+private:
+    bool gaussNewton;
+    double mu;                      // negative until set from the first Jacobian of a target
+    double nu;
+    double lastX, lastY;            // the target mu and nu belong to
+    ConvergenceStats last;
+    std::vector<double> saved;
+};
+
+/**
+ * Create the engine with the given name: "jacobian", "jacobian-ls"
+ * (line search), "jacobian-tr" (trust region), "ccd", "fabrik", "lm"
+ * (Levenberg-Marquardt) or "gauss-newton".
+ * \return a new engine, or null if the name is not recognised.
+ */
+IKSolver *newSolver(const std::string & name);
+
+/** Names accepted by newSolver(), terminated by a null pointer. */
+extern const char *solverNames[];
+
+#endif
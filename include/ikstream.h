@@ -0,0 +1,84 @@
+#ifndef IKSTREAM_H
+#define IKSTREAM_H
+
+/** \file ikstream.h
+ *  Solve a continuous stream of targets read from stdin, a file or a Unix socket.
+ *
+ *  A reader thread parses one target per line, "x y" or "x,y", and puts
+ *  it in a bounded queue.  The solver worker takes whatever is queued, up
+ *  to a batch, solves each target starting from the previous solution,
+ *  and writes the batch of joint angles out with one write and flush.
+ *  When the worker falls behind the queue fills and the reader stops
+ *  reading, so a pipe or socket sender blocks instead of buffers growing.
+ *
+ *  With prediction on, the worker also tracks the targets' motion and,
+ *  after each solve, leads the chain towards where the next target is
+ *  expected (see iktrack.h).
+ *
+ *  Output is one record per target, in input order:
+ *
+ *  - csv: "seq,iterations,error,a0,...,a(n-1)\n";
+ *  - binary: int32 seq, int32 iterations, float error, float a[n], in
+ *    native byte order, 12 + 4n bytes.
+ *
+ *  Latency is measured from the moment a target's line is parsed to the
+ *  flush of the batch that carries its solution.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "ikchain.h"
+#include "iksolver.h"
+#include "iktrack.h"
+#include "ikwarmstart.h"
+
+/** Settings of a streaming run. */
+struct StreamOptions
+{
+    StreamOptions()
+        : binary(false), batch(64), capacity(1024), tolerance(0.1), maxIterations(1000), table(0), predict(false)
+    {}
+
+    bool binary;                    /**< Write binary records rather than CSV. */
+    int batch;                      /**< Largest number of targets solved and written together. */
+    int capacity;                   /**< Targets that may wait in the queue before the reader blocks. */
+    double tolerance;               /**< Distance at which a target counts as reached. */
+    int maxIterations;              /**< Iterations after which the current angles are written anyway. */
+    const WorkspaceTable *table;    /**< If set, start each target from this table rather than the previous solution. */
+    bool predict;                   /**< Track the targets' motion and lead the chain towards the next one. */
+};
+
+/** Results of a streaming run. */
+struct StreamReport
+{
+    long targets;                   /**< Targets solved and written. */
+    long malformed;                 /**< Input lines that were not a target. */
+    long unreached;                 /**< Targets not reached within maxIterations. */
+    long batches;
+    double seconds;                 /**< From the first target read to the last batch written. */
+    double p50;                     /**< Median end-to-end latency in microseconds. */
+    double p99;                     /**< 99th percentile end-to-end latency in microseconds. */
+    double worst;                   /**< Longest end-to-end latency in microseconds. */
+    int highWater;                  /**< Largest number of targets waiting in the queue. */
+    double blocked;                 /**< Seconds the reader spent waiting for room in the queue. */
+};
+
+/**
+ * Read targets from \a in until end of file, solve them with \a solver on
+ * \a chain and write the solutions to \a out.
+ */
+StreamReport runStream(IKChain & chain, IKSolver & solver, FILE *in, FILE *out, const StreamOptions & options);
+
+/**
+ * Listen on the Unix socket \a path, accept one connection and open it
+ * for reading targets and writing solutions.  Any file at \a path is
+ * replaced.  \return false if the socket could not be set up, or on
+ * systems without Unix sockets.
+ */
+bool acceptUnixSocket(const std::string & path, FILE *& in, FILE *& out);
+
+/** Write \a report to \a os as text or, if \a json is true, as a JSON object. */
+void printStreamReport(std::ostream & os, const StreamReport & report, bool json);
+
+#endif
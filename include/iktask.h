@@ -0,0 +1,95 @@
+#ifndef IKTASK_H
+#define IKTASK_H
+
+/** \file iktask.h
+ *  A small work-stealing thread pool for running many independent IK solves.
+ *
+ *  parallelFor() cuts an index range into chunks and deals them out in
+ *  contiguous blocks, one block per worker deque, as a static partition
+ *  would.  Each worker takes chunks from the back of its own deque; when it
+ *  runs dry it steals from the front of another worker's deque, so a worker
+ *  whose chains converge quickly takes over work from one whose chains do
+ *  not.  The calling thread acts as worker 0 until the range is finished.
+ *
+ *  Each deque has its own mutex.  A chunk is a whole chain solve or more,
+ *  so the lock is a small cost and keeps the pool simple and portable.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskPool
+{
+public:
+    /**
+     * Start a pool of \a threads workers, including the thread that calls
+     * parallelFor().  Zero means one per hardware thread.
+     */
+    explicit TaskPool(int threads = 0);
+
+    /** Stop and join the workers. */
+    ~TaskPool();
+
+    /** Return the number of workers, including the calling thread. */
+    int threads() const { return workers; }
+
+    /**
+     * Enable or disable stealing.  Without it each worker runs only its own
+     * block, which is a static partition; this is for comparison.
+     */
+    void setStealing(bool enable) { stealing = enable; }
+
+    /**
+     * Call body(i) for every i in [0, count) and return when all calls have
+     * finished.  Indices are grouped into chunks of \a grain.  Calls may run
+     * concurrently and in any order.  Must not be called from inside a body.
+     */
+    void parallelFor(int count, const std::function<void(int)> & body, int grain = 1);
+
+    /** Return the number of chunks run by worker \a w since the pool started. */
+    long executed(int w) const { return queues[w]->executed; }
+
+    /** Return the number of chunks worker \a w took from other workers. */
+    long stolen(int w) const { return queues[w]->stolen; }
+
+private:
+    struct Chunk
+    {
+        int begin;
+        int end;
+    };
+
+    struct Queue
+    {
+        Queue() : executed(0), stolen(0) {}
+        std::mutex lock;
+        std::deque<Chunk> chunks;
+        long executed;      // written by the owner only
+        long stolen;
+        char pad[64];       // keep neighbouring queues' counters apart
+    };
+
+    void run(int w);
+    void drain(int w);
+    bool pop(int w, Chunk & c);
+    bool steal(int w, Chunk & c);
+
+    int workers;
+    std::atomic<bool> stealing;
+    bool stopping;
+    unsigned long generation;
+    std::atomic<const std::function<void(int)> *> body;
+    std::atomic<int> pending;
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::vector<std::thread> pool;
+    std::mutex sleep;
+    std::condition_variable wake;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef IKTRACK_H
+#define IKTRACK_H
+
+/** \file iktrack.h
+ *  Predict where a moving target will be, so the solver can start there.
+ *
+ *  TargetTracker is an alpha-beta filter: it keeps an estimate of the
+ *  target's position and velocity, corrects them by fractions alpha and
+ *  beta of the difference between each observation and its prediction,
+ *  and extrapolates at constant velocity.  With alpha = beta = 1 it is the
+ *  plain constant-velocity model, following the last two observations;
+ *  smaller values smooth out noisy targets at the cost of a slower response
+ *  to changes of speed.
+ *
+ *  leadTarget() moves a chain's joints by the Jacobian's first-order
+ *  increments towards the predicted target, so that the next solve starts
+ *  from where the tip will be needed rather than where it was.
+ */
+
+#include "ikchain.h"
+
+class TargetTracker
+{
+public:
+    /** Construct a tracker with the given gains, each in (0, 1]. */
+    explicit TargetTracker(double alpha = 0.8, double beta = 0.4)
+        : alpha(alpha), beta(beta), samples(0), px(0), py(0), vx(0), vy(0)
+    {}
+
+    /** Forget the target's motion. */
+    void reset() { samples = 0; vx = vy = 0; }
+
+    /** Add an observation of the target at (x, y), \a dt after the previous one. */
+    void observe(double x, double y, double dt = 1)
+    {
+        if (samples == 0 || !(dt > 0))
+        {
+            // The velocity is unknown until there are two observations
+            px = x;
+            py = y;
+            samples = samples ? samples : 1;
+            return;
+        }
+        double ex = x - (px + vx * dt), ey = y - (py + vy * dt);
+        double a = samples == 1 ? 1 : alpha, b = samples == 1 ? 1 : beta;
+        px += vx * dt + a * ex;
+        py += vy * dt + a * ey;
+        vx += b * ex / dt;
+        vy += b * ey / dt;
+        ++samples;
+    }
+
+    /** Return the number of observations since the last reset(). */
+    int observations() const { return samples; }
+
+    /** Predict the target's position \a ahead after the last observation. */
+    void predict(double ahead, double & x, double & y) const
+    {
+        x = px + vx * ahead;
+        y = py + vy * ahead;
+    }
+
+    /** Return the estimated x velocity. */
+    double velocityX() const { return vx; }
+
+    /** Return the estimated y velocity. */
+    double velocityY() const { return vy; }
+
+private:
+    double alpha;
+    double beta;
+    int samples;
+    double px, py;
+    double vx, vy;
+};
+
+/**
+ * Move the joints of \a chain by one solveStep() towards the target
+ * predicted \a ahead after the tracker's last observation.  Does nothing
+ * until the tracker has seen the target move.
+ */
+inline void leadTarget(IKChain & chain, const TargetTracker & tracker, double ahead = 1)
+{
+    if (tracker.observations() < 2)
+        return;
+    double x, y;
+    tracker.predict(ahead, x, y);
+    chain.forward();
+    chain.solveStep(x - chain.tipX(), y - chain.tipY());
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef IKTREE_H
+#define IKTREE_H
+
+/** \file iktree.h
+ *  Planar inverse kinematics for a branching tree of links with several end effectors.
+ *
+ *  Joints are added parent first, so a joint's index is always greater
+ *  than its parent's.  Each joint rotates its link relative to its parent's
+ *  link, as in IKChain, and the root joints sit at the origin.  An end
+ *  effector is the far end of a link, and it moves with every joint on the
+ *  path from the root to that link.
+ *
+ *  The stacked Jacobian of all effectors is sparse: effector \a e has
+ *  non-zero columns only on its own path, and joints shared by several
+ *  paths appear once.  solveStep() solves the damped normal equations
+ *  (J^T J + lambda^2 I) d = J^T e.  J^T J has an entry (j, k) only if one
+ *  of j and k is an ancestor of the other, so eliminating descendants
+ *  before ancestors creates no fill-in: the Cholesky factor has the same
+ *  pattern, stored as one row per joint over its ancestors, and costs the
+ *  sum of the squared joint depths rather than n^3.  Storage grows as
+ *  joints and effectors are added; forward() and solveStep() do not allocate.
+ */
+
+#include <vector>
+
+class IKTree
+{
+public:
+    IKTree();
+
+    /**
+     * Add a joint and its link.
+     * \param parent is the index of the parent joint, or -1 for a root at the origin.
+     * \param length is the length of the link.
+     * \param initialAngle is the starting angle of the joint.
+     * \return the index of the new joint.
+     */
+    int addJoint(int parent, double length, double initialAngle = 0);
+
+    /**
+     * Make the far end of joint \a joint's link an end effector.  Its target
+     * starts at its current position.
+     * \return the index of the new effector.
+     */
+    int addEffector(int joint);
+
+    /** Return the number of joints. */
+    int size() const { return n; }
+
+    /** Return the number of end effectors. */
+    int effectors() const { return int(effectorJoint.size()); }
+
+    /** Return the parent of joint \a i, or -1 for a root. */
+    int parent(int i) const { return parents[i]; }
+
+    /** Return the angle of joint \a i. */
+    double angle(int i) const { return angles[i]; }
+
+    /** Set the angle of joint \a i.  Call forward() before using positions or the Jacobian. */
+    void setAngle(int i, double a) { angles[i] = a; }
+
+    /** Return the length of the longest path from a root to the end of a link. */
+    double reach() const { return longest; }
+
+    /** Compute the link end points and the Jacobian of every effector. */
+    void forward();
+
+    /** Return the x coordinate of the far end of joint \a i's link computed by the last forward(). */
+    double endX(int i) const { return ex[i]; }
+
+    /** Return the y coordinate of the far end of joint \a i's link computed by the last forward(). */
+    double endY(int i) const { return ey[i]; }
+
+    /** Return the x coordinate of effector \a e computed by the last forward(). */
+    double effectorX(int e) const { return ex[effectorJoint[e]]; }
+
+    /** Return the y coordinate of effector \a e computed by the last forward(). */
+    double effectorY(int e) const { return ey[effectorJoint[e]]; }
+
+    /** Set the target of effector \a e. */
+    void setTarget(int e, double x, double y);
+
+    /** Return the largest distance from an effector to its target after the last forward(). */
+    double error() const;
+
+    /** Set the damping factor lambda.  The default is 1% of reach(). */
+    void setDamping(double lambda) { damping = lambda; }
+
+    /**
+     * Move every effector towards its target by at most \a step, to first
+     * order, using the Jacobian from the last forward().
+     * \return false if the normal equations could not be factored (only
+     * possible with zero damping), in which case the joints are unchanged.
+     */
+    bool solveStep(double step);
+
+    /**
+     * Iterate forward() and solveStep() until error() is below \a tolerance
+     * or \a maxIterations steps have been made.  forward() is up to date on
+     * return.
+     * \return the number of steps made.
+     */
+    int solve(double step, double tolerance, int maxIterations);
+
+private:
+    bool factor();
+
+    int n;
+    double damping;                         // negative for 1% of reach()
+    double longest;
+    std::vector<int> parents;
+    std::vector<int> depth;                 // number of ancestors
+    std::vector<int> ancestorStart;         // joint j's ancestors, parent first, start here in ancestors and lower
+    std::vector<int> ancestors;
+    std::vector<double> lengths;
+    std::vector<double> pathLength;         // from the root to the end of the link
+    std::vector<double> angles;
+    std::vector<double> theta;
+    std::vector<double> sines;
+    std::vector<double> cosines;
+    std::vector<double> ex;
+    std::vector<double> ey;
+
+    std::vector<int> effectorJoint;
+    std::vector<double> targetX;
+    std::vector<double> targetY;
+    std::vector<int> columnStart;           // effector e's columns, for its joint then its ancestors, start here
+    std::vector<double> jx;
+    std::vector<double> jy;
+
+    std::vector<double> diagonal;           // J^T J + lambda^2 I, then its Cholesky factor
+    std::vector<double> lower;              // entry (j, k) for k an ancestor of j
+    std::vector<double> rhs;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef IKWARMSTART_H
+#define IKWARMSTART_H
+
+/** \file ikwarmstart.h
+ *  A precomputed table of joint configurations over the workspace, for warm starts.
+ *
+ *  The table samples the square [-reach, reach]^2 on a regular grid of
+ *  resolution x resolution nodes and stores, for every node the arm can
+ *  reach, a configuration that puts the tip there.  Every node is solved
+ *  from a canonical pose that varies smoothly over the workspace, so
+ *  neighbouring configurations belong to the same branch and can be
+ *  blended.  A lookup interpolates the four nodes around a target
+ *  bilinearly, leaving the solver only a short refinement.
+ *
+ *  Memory is resolution^2 x links floats plus a byte per node: 64 x 64 for
+ *  the four-link arm is 68 KB and 256 x 256 is 1.1 MB.  Finer grids start
+ *  the arm closer to its target.  Tables are built offline by IK_LUT and
+ *  loaded from disk with load().
+ */
+
+#include <string>
+#include <vector>
+#include "ikchain.h"
+
+class WorkspaceTable
+{
+public:
+    /** Construct an empty table; lookups fail until build() or load(). */
+    WorkspaceTable();
+
+    /**
+     * Solve for every node of a \a resolution x \a resolution grid over the
+     * workspace of an arm with the link lengths of \a chain.
+     * \param tolerance is the distance within which a node counts as reached.
+     * \return the number of nodes reached.
+     */
+    int build(const IKChain & chain, int resolution, double tolerance = 0.01);
+
+    /** Write the table to \a path.  \return false if the file could not be written. */
+    bool save(const std::string & path) const;
+
+    /** Read a table written by save().  \return false if the file is missing or malformed. */
+    bool load(const std::string & path);
+
+    /** Return true if the table was built for an arm with the link lengths of \a chain. */
+    bool matches(const IKChain & chain) const;
+
+    /** Return the number of grid nodes along each side, or 0 for an empty table. */
+    int resolution() const { return res; }
+
+    /** Return the number of nodes with a stored configuration. */
+    int reachedNodes() const;
+
+    /** Return the memory used by the table in bytes. */
+    size_t bytes() const { return table.size() * sizeof(float) + valid.size(); }
+
+    /**
+     * Interpolate a configuration for the target (x, y) from the reached
+     * nodes at the corners of its grid cell.
+     * \param angles receives one angle per link.
+     * \return false if no corner of the cell was reached.
+     */
+    bool lookup(double x, double y, double angles[]) const;
+
+    /**
+     * Set the joints of \a chain to the configuration for (x, y), if there
+     * is one.  \return true if the joints were changed.
+     */
+    bool warmStart(IKChain & chain, double x, double y) const;
+
+private:
+    int cell(double x, double y, int node[4], double weight[4]) const;
+    double interpolate(int i, const int node[4], const double weight[4], int corners) const;
+
+    int n;
+    int res;
+    double extent;                  // the grid covers [-extent, extent]^2
+    std::vector<double> lengths;
+    std::vector<float> table;       // node (row, col) at (row * res + col) * n
+    std::vector<unsigned char> valid;
+};
+
+#endif
@@ -0,0 +1,191 @@
+// Load generator for the IK solve service.
+// Usage: IK_LOAD [--socket PATH] [--clients N,N,...] [--seconds S] [--pipeline K]
+// Without --socket a service for the demo arm is started in this process.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "include/ikrandom.h"
+#include "include/ikservice.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Targets are drawn for the reach of the demo arm
+const double demoLengths[] = { 25, 20, 15, 10 };
+const double reach = 70;
+
+void usage()
+{
+    cout << "Usage: IK_LOAD [options]\n"
+         << "  --socket PATH     Service to load (default: start one for the demo arm)\n"
+         << "  --clients LIST    Comma-separated client counts (default 1,2,4,8,16,32)\n"
+         << "  --seconds S       Duration of each load level (default 1)\n"
+         << "  --pipeline K      Requests each client keeps in flight (default 1)\n";
+}
+
+// One client: keep `pipeline` requests in flight until the deadline and
+// collect the latency of every answer in microseconds
+void client(const string & path, unsigned int seed, int pipeline, Clock::time_point deadline,
+            vector<double> & latencies, bool & ok)
+{
+    IKClient c;
+    ok = c.connect(path);
+    if (!ok)
+        return;
+    IKRandom rng(seed);
+    vector<Clock::time_point> sentAt(pipeline);
+    IKResponse r;
+    int id = 0;
+    for (; id < pipeline; ++id)
+    {
+        double x, y;
+        rng.target(reach, x, y);
+        sentAt[id % pipeline] = Clock::now();
+        ok = ok && c.request(id, x, y);
+    }
+    while (ok)
+    {
+        if (!c.response(r))
+        {
+            ok = false;
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        latencies.push_back(chrono::duration<double, micro>(now - sentAt[r.id % pipeline]).count());
+        if (now >= deadline)
+        {
+            if (r.id == id - 1)
+                break;
+            continue;
+        }
+        double x, y;
+        rng.target(reach, x, y);
+        sentAt[id % pipeline] = Clock::now();
+        ok = c.request(id++, x, y);
+    }
+}
+
+double percentile(vector<double> & values, double p)
+{
+    if (values.empty())
+        return 0;
+    size_t k = min(values.size() - 1, size_t(p * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+int main(int argc, char *argv[])
+{
+    string path;
+    vector<int> counts;
+    double seconds = 1;
+    int pipeline = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue)
+            path = argv[++i];
+        else if (arg == "--clients" && hasValue)
+        {
+            stringstream list(argv[++i]);
+            string item;
+            while (getline(list, item, ','))
+                counts.push_back(atoi(item.c_str()));
+        }
+        else if (arg == "--seconds" && hasValue)
+            seconds = atof(argv[++i]);
+        else if (arg == "--pipeline" && hasValue)
+            pipeline = atoi(argv[++i]);
+        else
+        {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (counts.empty())
+    {
+        const int levels[] = { 1, 2, 4, 8, 16, 32 };
+        counts.assign(levels, levels + 6);
+    }
+    if (pipeline < 1 || seconds <= 0 || *min_element(counts.begin(), counts.end()) < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    // The in-process service solves with damped least squares and line search
+    unique_ptr<IKService> service;
+    thread serving;
+    if (path.empty())
+    {
+        IKChain arm(demoLengths, 4, -atan(1.0));
+        arm.setMethod(DAMPED_LEAST_SQUARES);
+        path = "/tmp/ik_load_" + to_string(chrono::steady_clock::now().time_since_epoch().count() % 1000000) + ".sock";
+        service.reset(new IKService(arm, "jacobian-ls"));
+        if (!service->listen(path))
+        {
+            cerr << "IK_LOAD: cannot listen on " << path << endl;
+            return 1;
+        }
+        serving = thread(&IKService::run, service.get());
+    }
+
+    printf("%8s %12s %10s %10s %10s %12s\n", "clients", "requests/s", "p50 us", "p99 us", "max us", "mean batch");
+    for (size_t level = 0; level < counts.size(); ++level)
+    {
+        int n = counts[level];
+        vector<vector<double> > latencies(n);
+        vector<char> ok(n);
+        vector<thread> threads;
+        long batches = service ? service->batches() : 0, answered = service ? service->requests() : 0;
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + chrono::microseconds(long(seconds * 1e6));
+        for (int k = 0; k < n; ++k)
+            threads.push_back(thread([&, k] {
+                bool good;
+                client(path, 1000 + k, pipeline, deadline, latencies[k], good);
+                ok[k] = good;
+            }));
+        for (int k = 0; k < n; ++k)
+            threads[k].join();
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+        vector<double> all;
+        bool good = true;
+        for (int k = 0; k < n; ++k)
+        {
+            all.insert(all.end(), latencies[k].begin(), latencies[k].end());
+            good = good && ok[k];
+        }
+        if (!good)
+        {
+            cerr << "IK_LOAD: lost the connection to " << path << endl;
+            break;
+        }
+        double worst = all.empty() ? 0 : *max_element(all.begin(), all.end());
+        printf("%8d %12.0f %10.1f %10.1f %10.1f", n, all.size() / elapsed, percentile(all, 0.50),
+               percentile(all, 0.99), worst);
+        if (service && service->batches() > batches)
+            printf(" %12.2f\n", double(service->requests() - answered) / (service->batches() - batches));
+        else
+            printf(" %12s\n", "-");
+    }
+
+    if (service)
+    {
+        service->stop();
+        serving.join();
+    }
+    return 0;
+}
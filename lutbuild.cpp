@@ -0,0 +1,93 @@
+// Build a workspace table of warm-start configurations for the demo arm.
+// Usage: IK_LUT [--resolution N] [--out FILE] [--lengths L1,L2,...]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "include/ikchain.h"
+#include "include/ikrandom.h"
+#include "include/ikwarmstart.h"
+
+using namespace std;
+
+void usage()
+{
+    cout << "Usage: IK_LUT [options]\n"
+         << "  --resolution N    Grid nodes along each side (default 64)\n"
+         << "  --out FILE        Table file to write (default workspace.iklut)\n"
+         << "  --lengths LIST    Comma-separated link lengths, base first (default 25,20,15,10)\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int resolution = 64;
+    string out = "workspace.iklut";
+    vector<double> lengths;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--resolution" && hasValue)
+            resolution = atoi(argv[++i]);
+        else if (arg == "--out" && hasValue)
+            out = argv[++i];
+        else if (arg == "--lengths" && hasValue)
+        {
+            stringstream list(argv[++i]);
+            string item;
+            while (getline(list, item, ','))
+                lengths.push_back(atof(item.c_str()));
+        }
+        else
+        {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (lengths.empty())
+    {
+        const double demo[] = { 25, 20, 15, 10 };
+        lengths.assign(demo, demo + 4);
+    }
+    if (resolution < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    IKChain arm(lengths);
+    WorkspaceTable table;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int reached = table.build(arm, resolution);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!table.save(out))
+    {
+        cerr << "IK_LUT: cannot write " << out << endl;
+        return 1;
+    }
+
+    // Distance from the interpolated configuration to random targets, before any refinement
+    IKRandom rng;
+    double total = 0, worst = 0;
+    const int samples = 10000;
+    for (int k = 0; k < samples; ++k)
+    {
+        double tX, tY;
+        rng.target(arm.reach(), tX, tY);
+        if (!table.warmStart(arm, tX, tY))
+            continue;
+        arm.forward();
+        double d = sqrt((tX - arm.tipX()) * (tX - arm.tipX()) + (tY - arm.tipY()) * (tY - arm.tipY()));
+        total += d;
+        worst = max(worst, d);
+    }
+    cout << out << ": " << resolution << " x " << resolution << " nodes, " << reached << " reached, "
+         << table.bytes() << " bytes, built in " << seconds << " s" << endl
+         << "warm start error over " << samples << " random targets: mean " << total / samples
+         << ", max " << worst << endl;
+    return 0;
+}
@@ -2,9 +2,28 @@
 
 // Link with libcugl libglut32 libopengl32 libglu32
 
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include "include/cugl.h"
+#include "GLUT/GL/freeglut_ext.h"
+#include "include/headless.h"
+#include "include/ikchain.h"
+#include "include/ikgeometry.h"
+#include "include/ikhierarchy.h"
+#include "include/ikinstanced.h"
+#include "include/ikrandom.h"
+#include "include/ikreach.h"
+#include "include/ikservice.h"
+#include "include/ikrecord.h"
+#include "include/iksolver.h"
+#include "include/ikstream.h"
+#include "include/iktask.h"
+#include "include/ikwarmstart.h"
 
 using namespace std;
 using namespace cugl;
@@ -21,139 +40,264 @@ GLfloat white[] = { 1.0, 1.0, 1.0, 1.0 };
 GLfloat shiny[] = { 50 };
 GLfloat dir[] = { 0.0, 0.0, 1.0, 0.0 };
 
-class Link
-{
-public:
-    Link(double length, GLfloat *col) : length(length), radius(length/20), col(col)
-    {
-        bar = gluNewQuadric();
-        gluQuadricDrawStyle(bar, GLU_FILL);
-        gluQuadricOrientation(bar, GLU_OUTSIDE);
-        gluQuadricNormals(bar, GLU_SMOOTH);
-    }
-
-    void draw()
-    {
-        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, col);
-        glRotated(degrees(angle), 1, 0, 0);
-        gluCylinder(bar, radius, radius, length, 20, 20);
-        glTranslated(0, 0, length);
-        glutSolidSphere(1.5 * radius, 20, 20);
-        for (vector<Link*>::const_iterator i = pLinks.begin(); i != pLinks.end(); ++i)
-        {
-            glPushMatrix();
-            (*i)->draw();
-            glPopMatrix();
-        }
-    }
-
-    void addLink(Link *p)
-    {
-        pLinks.push_back(p);
-    }
-
-    void setRot(double newAngle)
-    {
-        angle = newAngle;
-    }
+// Meshes shared by every link's cylinder and joint, and the target
+GeometryCache *geometry;
+
+// The arm has four links, base first
+const int numLinks = 4;
+const double linkLengths[numLinks] = { 25, 20, 15, 10 };
+GLfloat *linkColours[numLinks] = { red, green, blue, white };
+
+// The links as drawn, each attached to the end of the one before, and a
+// display list per link that is recompiled only when its transform or
+// level of detail changes
+LinkHierarchy links;
+GLuint linkLists;
+
+// Levels of detail of each link's cylinder and joint, the target and the
+// base, and the triangles in each link's display list; detailStale asks
+// for every level to be chosen again after the projection changes
+const double fieldOfView = 40;
+int cylinderDetail[numLinks];
+int jointDetail[numLinks];
+int linkTriangles[numLinks];
+int targetDetail = -1;
+int baseDetail = -1;
+bool detailStale = true;
+
+// Copies of the arm drawn on a grid by the instanced core-profile renderer,
+// or 0 for the fixed-function path, and the level of detail of the crowd
+int arms = 0;
+const double armSpacing = 80;
+InstancedRenderer *crowd;
+int crowdDetail = -1;
+
+// Frames drawn, link transforms recomputed for them and triangles in the last
+long framesDrawn = 0;
+long nodesUpdated = 0;
+long trianglesDrawn = 0;
+
+// Joint angles and Jacobian of the arm, and the engine that moves it
+IKChain* arm;
+IKSolver* solver;
+int solverIndex = 0;
 
-private:
-    double length;
-    double radius;
-    GLfloat *col;
-    double angle;
-    vector<Link*> pLinks;
-    GLUquadricObj *bar;
-};
+// Target point - moved when the arm has reached it
+double tX = linkLengths[2];
+double tY = linkLengths[3];
 
-// The arm has three components
-Link* link_1;
-const double link_1_length = 25;
-double a_1 = -PI/4;
+// Control step size
+double step = 0.01;
 
-Link* link_2;
-const double link_2_length = 20;
-double a_2 = -PI/4;
+// Source of targets; the seed can be set on the command line
+IKRandom rng;
 
-Link* link_3;
-const double link_3_length = 15;
-double a_3 = -PI/4;
+// Configurations to start each target from, if a table was given
+WorkspaceTable table;
 
-Link* link_4;
-const double link_4_length = 10;
-double a_4 = -PI/4;
+// Where the tip can go, if targets are screened, and whether unreachable
+// targets are clamped into reach or drawn again
+ReachabilityMap reachMap;
+bool clampTargets = false;
 
-// Target point - moved when the arm has reached it
-double tX = link_3_length;
-double tY = link_4_length;
+// Recording of the session, if one was asked for
+SessionRecorder *recorder = 0;
 
-// Current position of tip
-double x;
-double y;
+// The solve service, stopped by SIGINT or SIGTERM
+IKService *service = 0;
 
-// Control step size
-double step = 0.01;
+void stopService(int)
+{
+    service->stop();
+}
 
 // Choose a random target for the tip to aim at
 void chooseTarget()
 {
-    double rad = 0, ang = 2 * PI * randReal();
-    rad = 2 + (link_1_length + link_2_length + link_3_length + link_4_length - 3) * randReal();
-    tX = rad * cos(ang);
-    tY = rad * sin(ang);
+    rng.target(arm->reach(), tX, tY);
+    if (clampTargets)
+        reachMap.clamp(tX, tY);
+    for (int tries = 0; tries < 1000 && !reachMap.reachable(tX, tY); ++tries)
+        rng.target(arm->reach(), tX, tY);
+    table.warmStart(*arm, tX, tY);
+    if (recorder)
+        recorder->target(tX, tY, *arm);
 }
 
-// Initialize arm and target
+// Initialize arm and solver
+void initializeArm(const string & solverName, IKMethod method)
+{
+    arm = new IKChain(linkLengths, numLinks, -PI/4);
+    arm->setMethod(method);
+    solver = solverName == "jacobian" ? new JacobianSolver(step) : newSolver(solverName);
+    for (solverIndex = 0; solverNames[solverIndex] != solverName; ++solverIndex)
+        ;
+}
+
+// Initialize links and target
 void initialize()
 {
-    link_1 = new Link(link_1_length, red);
-    link_2 = new Link(link_2_length, green);
-    link_3 = new Link(link_3_length, blue);
-    link_4 = new Link(link_4_length, white);
-    link_1->addLink(link_2);
-    link_2->addLink(link_3);
-    link_3->addLink(link_4);
+    if (arms > 0)
+    {
+        crowd = new InstancedRenderer;
+        if (!crowd->initialize())
+        {
+            cerr << "Instanced rendering: " << crowd->error() << endl;
+            exit(1);
+        }
+    }
+    else
+    {
+        geometry = new GeometryCache;
+        geometry->prepare();
+        linkLists = glGenLists(numLinks);
+    }
+    for (int i = 0; i < numLinks; ++i)
+        links.add(i - 1, linkLengths[i], arm->angle(i));
+    for (int i = 0; i < numLinks; ++i)
+        cylinderDetail[i] = jointDetail[i] = -1;
     chooseTarget();
 }
 
+// Distance in front of the camera of the point (x, y, z) under the modelview matrix view
+double eyeDepth(const GLdouble *view, double x, double y, double z)
+{
+    return -(view[2] * x + view[6] * y + view[10] * z + view[14]);
+}
+
+// Draw the arm at every point of a square grid, with the target relative
+// to each, in one instanced draw call for the cylinders and one for the spheres
+void displayCrowd()
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    int side = int(ceil(sqrt(double(arms))));
+    double extent = (side - 1) * armSpacing;
+    double distance = 200 + extent, elevation = side > 1 ? PI / 6 : 0;
+
+    // A single arm is seen as the fixed-function path sees it, a grid from above
+    double eye[3] = { -distance * cos(elevation), distance * sin(elevation), 0 };
+    double centre[3] = { 0, 0, 0 }, up[3] = { 0, 1, 0 };
+    float projection[16], view[16];
+    perspectiveMatrix(projection, fieldOfView, double(windowWidth) / windowHeight, 1, distance + extent + 200);
+    lookAtMatrix(view, eye, centre, up);
+    crowdDetail = selectDetail(projectedRadius(1.5 * linkLengths[0] / 20, distance, fieldOfView, windowHeight), crowdDetail);
+
+    links.update();
+    crowd->clear();
+    for (int a = 0; a < arms; ++a)
+    {
+        double x = (a / side - 0.5 * (side - 1)) * armSpacing, z = (a % side - 0.5 * (side - 1)) * armSpacing;
+        double place[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, 0, z, 1 };
+        crowd->add(SPHERE, place, 3, 3, 3, blue);
+        place[13] = -tY;
+        place[14] = z + tX;
+        crowd->add(SPHERE, place, 1, 1, 1, blue);
+        for (int i = 0; i < links.size(); ++i)
+        {
+            double world[16];
+            memcpy(world, links.world(i), sizeof(world));
+            world[12] += x;
+            world[14] += z;
+            double length = links.length(i), radius = length / 20;
+            crowd->add(CYLINDER, world, radius, radius, length, linkColours[i]);
+            for (int r = 0; r < 3; ++r)
+                world[12 + r] += length * world[8 + r];
+            crowd->add(SPHERE, world, 1.5 * radius, 1.5 * radius, 1.5 * radius, linkColours[i]);
+        }
+    }
+    crowd->draw(projection, view, dir, crowdDetail);
+    ++framesDrawn;
+    nodesUpdated += long(links.updatedLinks().size());
+    trianglesDrawn = crowd->triangles();
+
+    glutSwapBuffers();
+}
+
 void display (void)
 {
+    if (crowd)
+    {
+        displayCrowd();
+        return;
+    }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
     glTranslated(0, 0, -200);
     glRotated(90, 0, 1, 0);
+    GLdouble view[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, view);
 
     // Show target
     glPushMatrix();
     glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, blue);
     glTranslated(0, -tY, tX);
-    glutSolidSphere(1, 20, 20);
+    targetDetail = selectDetail(projectedRadius(1, eyeDepth(view, 0, -tY, tX), fieldOfView, windowHeight), targetDetail);
+    geometry->sphere(1, targetDetail);
     glPopMatrix();
 
-    // Draw robot arm
-    glutSolidSphere(3, 20, 20);
-    link_1->draw();
+    // Draw robot arm: each link from its world transform, so the depth of
+    // the hierarchy is not limited by the matrix stack.  Only the links
+    // below a joint that turned are recomputed, and only they, or all of
+    // them after the projection changes, choose their level of detail.
+    baseDetail = selectDetail(projectedRadius(3, eyeDepth(view, 0, 0, 0), fieldOfView, windowHeight), baseDetail);
+    geometry->sphere(3, baseDetail);
+    trianglesDrawn = GeometryCache::triangles(SPHERE, targetDetail) + GeometryCache::triangles(SPHERE, baseDetail);
+    links.update();
+    const vector<int> & updated = links.updatedLinks();
+    bool recompile[numLinks] = { false };
+    for (size_t k = 0; k < updated.size(); ++k)
+        recompile[updated[k]] = true;
+    for (int i = 0; i < links.size(); ++i)
+    {
+        if (!recompile[i] && !detailStale)
+            continue;
+        const double *w = links.world(i);
+        double length = links.length(i), radius = length / 20;
+        double middle = eyeDepth(view, w[12] + 0.5 * length * w[8], w[13] + 0.5 * length * w[9], w[14] + 0.5 * length * w[10]);
+        double end = eyeDepth(view, w[12] + length * w[8], w[13] + length * w[9], w[14] + length * w[10]);
+        int cylinder = selectDetail(projectedRadius(radius, middle, fieldOfView, windowHeight), cylinderDetail[i]);
+        int joint = selectDetail(projectedRadius(1.5 * radius, end, fieldOfView, windowHeight), jointDetail[i]);
+        if (cylinder != cylinderDetail[i] || joint != jointDetail[i])
+            recompile[i] = true;
+        cylinderDetail[i] = cylinder;
+        jointDetail[i] = joint;
+    }
+    detailStale = false;
+    for (int i = 0; i < links.size(); ++i)
+    {
+        if (recompile[i])
+        {
+            double length = links.length(i), radius = length / 20;
+            glNewList(linkLists + i, GL_COMPILE);
+            glPushMatrix();
+            glMultMatrixd(links.world(i));
+            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, linkColours[i]);
+            geometry->cylinder(radius, length, cylinderDetail[i]);
+            glTranslated(0, 0, length);
+            geometry->sphere(1.5 * radius, jointDetail[i]);
+            glPopMatrix();
+            glEndList();
+            linkTriangles[i] = GeometryCache::triangles(CYLINDER, cylinderDetail[i]) + GeometryCache::triangles(SPHERE, jointDetail[i]);
+        }
+        glCallList(linkLists + i);
+        trianglesDrawn += linkTriangles[i];
+    }
+    ++framesDrawn;
+    nodesUpdated += long(updated.size());
 
     glutSwapBuffers();
 }
 
 void idle()
 {
-    static double oldDA1 = 0;
-    static double oldDA2 = 0;
-    static double oldDA3 = 0;
-    static double oldDA4 = 0;
-
     // Current position of tip
-    x = link_1_length * cos(a_1) + link_2_length * cos(a_1 + a_2) + link_3_length * cos(a_1 + a_2 + a_3)
-            + link_4_length * cos(a_1 + a_2 + a_3 + a_4);
-    y = link_1_length * sin(a_1) + link_2_length * sin(a_1 + a_2) + link_3_length * sin(a_1 + a_2 + a_3)
-        + link_4_length * sin(a_1 + a_2 + a_3 + a_4);
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    arm->forward();
 
     // Position of tip relative to target
-    double deltaX = tX - x;
-    double deltaY = tY - y;
+    double deltaX = tX - arm->tipX();
+    double deltaY = tY - arm->tipY();
 
     // If tip is close to target, move the tartget
     double dist = sqrt(deltaX * deltaX + deltaY * deltaY);
@@ -163,105 +307,16 @@ void idle()
         return;
     }
 
-    // Scale deltas according to distance
-    double rd = step / dist;
-    deltaX *= rd;
-    deltaY *= rd;
-
-    // Find partial derivatives
-    double dx_da4 = - link_4_length * sin(a_1 + a_2 + a_3 + a_4);
-    double dx_da3 = - link_3_length * sin(a_1 + a_2 + a_3) + dx_da4;
-    double dx_da2 = - link_2_length * sin(a_1 + a_2) + dx_da3;
-    double dx_da1 = - link_1_length * sin(a_1) + dx_da2;
-
-    double dy_da4 = link_4_length * cos(a_1 + a_2 + a_3 + a_4);
-    double dy_da3 = link_3_length * cos(a_1 + a_2 + a_3) + dx_da4;
-    double dy_da2 = link_2_length * cos(a_1 + a_2) + dx_da3;
-    double dy_da1 = link_1_length * cos(a_1) + dx_da2;
-
-    // Set up Jacobian J
-    double j[2][4];
-    j[0][0] = dx_da1;
-    j[0][1] = dx_da2;
-    j[0][2] = dx_da3;
-    j[0][3] = dx_da4;
-    j[1][0] = dy_da1;
-    j[1][1] = dy_da2;
-    j[1][2] = dy_da3;
-    j[1][3] = dy_da4;
-
-    // Compute transposed Jacobian J^T
-    double jt[4][2];
-    for (int r = 0; r < 4; ++r)
-        for (int c = 0; c < 2; ++c)
-            jt[r][c] = j[c][r];
-
-    // Compute product J J^T
-    double jjt[2][2];
-    for (int r = 0; r < 2; ++r)
-        for (int c = 0; c < 2; ++c)
-        {
-            jjt[r][c] = 0;
-            for (int k = 0; k < 4; ++k)
-                jjt[r][c] += j[r][k] * jt[k][c];
-        }
-
-    // Set angle increments with old values in case there is a singularity
-    double deltaA1 = oldDA1;
-    double deltaA2 = oldDA2;
-    double deltaA3 = oldDA3;
-    double deltaA4 = oldDA4;
-
-    // Compute determinant
-    double det = jjt[0][0] * jjt[1][1] - jjt[0][1] * jjt[1][0];
-    if (det == 0)
-    {
+    // Move the arm one iteration of the current engine; the Jacobian engine
+    // reuses the previous increments if there is a singularity
+    if (!solver->iterate(*arm, tX, tY))
         cerr << "Singularity!\n";
-    }
-    else
-    {
-        // Determinant is non-zero, so compute inverse
-        double jjti[2][2];
-        jjti[0][0] =   jjt[1][1] / det;
-        jjti[0][1] = - jjt[0][1] / det;
-        jjti[1][0] = - jjt[1][0] / det;
-        jjti[1][1] =   jjt[0][0] / det;
-
-        // Pseudoinverse = transpose * inverse
-        double psi[4][2];
-        for (int r = 0; r < 4; ++r)
-            for (int c = 0; c < 2; ++c)
-            {
-                psi[r][c] = 0;
-                for (int k = 0; k < 2; ++k)
-                    psi[r][c] += jt[r][k] * jjti[k][c];
-            }
-
-        // Obtain angle increments from pseudo-inverse
-        deltaA1 = psi[0][0] * deltaX + psi[0][1] * deltaY;
-        deltaA2 =   psi[1][0] * deltaX + psi[1][1] * deltaY;
-        deltaA3 =   psi[2][0] * deltaX + psi[2][1] * deltaY;
-        deltaA4 =   psi[3][0] * deltaX + psi[3][1] * deltaY;
-
-        // Save increments in case we need them
-        oldDA1 = deltaA1;
-        oldDA2 = deltaA2;
-        oldDA3 = deltaA3;
-        oldDA4 = deltaA4;
-    }
-
-    // Update angles and arm positions
-    a_1 += deltaA1;
-    link_1->setRot(a_1);
-
-    a_2 += deltaA2;
-    link_2->setRot(a_2);
-
-    a_3 += deltaA3;
-    link_3->setRot(a_3);
+    if (recorder)
+        recorder->step(*arm, long(chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count()));
 
-    a_4 += deltaA4;
-    link_4->setRot(a_4);
+    // Update arm positions
+    for (int i = 0; i < numLinks; ++i)
+        links.setAngle(i, arm->angle(i));
 
     glutPostRedisplay();
 }
@@ -271,8 +326,38 @@ void keyboard (unsigned char key, int x, int y)
     switch (key)
     {
         case 27:
+            delete recorder;
+            delete geometry;
+            delete crowd;
             exit(0);
             break;
+        case 's':
+            // FABRIK ignores joint limits, so a limited arm skips it
+            do
+                if (!solverNames[++solverIndex])
+                    solverIndex = 0;
+            while (arm->lowerLimit(numLinks - 1) != -HUGE_VAL && solverNames[solverIndex] == string("fabrik"));
+            delete solver;
+            solver = solverIndex == 0 ? new JacobianSolver(step) : newSolver(solverNames[solverIndex]);
+            cout << "\nSolver " << solver->name();
+            if (recorder)
+                recorder->solver(solver->name(), *arm);
+            break;
+        case 'm':
+            arm->setMethod(IKMethod((arm->method() + 1) % 3));
+            cout << "\nMethod " << methodNames[arm->method()];
+            if (recorder)
+                recorder->solver(solver->name(), *arm);
+            break;
+        case 'u':
+            cout << "\nNodes updated " << links.updatedLinks().size() << " last frame, "
+                 << (framesDrawn ? double(nodesUpdated) / framesDrawn : 0) << " per frame over " << framesDrawn << " frames, ";
+            if (crowd)
+                cout << crowd->instances() << " instances in " << crowd->drawCalls() << " draw calls, ";
+            else
+                cout << geometry->meshes() << " meshes, ";
+            cout << trianglesDrawn << " triangles last frame";
+            break;
     }
 }
 
@@ -281,17 +366,252 @@ void reshape (int w, int h)
     windowWidth = w;
     windowHeight = h;
     glViewport(0, 0, windowWidth, windowHeight);
+    if (crowd)
+    {
+        glutPostRedisplay();
+        return;
+    }
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(40, double(w)/double(h), 1, 200);
+    gluPerspective(fieldOfView, double(w)/double(h), 1, 200);
+    detailStale = true;
     glutPostRedisplay();
 }
 
+void usage()
+{
+    cout << "Usage: COMP_477_A2 [options]\n"
+         << "  --solver NAME     IK engine:";
+    for (int i = 0; solverNames[i]; ++i)
+        cout << ' ' << solverNames[i];
+    cout << " (default jacobian, or jacobian-ls with --stream or --serve)\n"
+         << "  --method NAME     Jacobian method: pinv dls svd (default pinv)\n"
+         << "  --seed N          Seed of the target generator\n"
+         << "  --table FILE      Warm start each target from a table built by IK_LUT\n"
+         << "  --limits DEG      Limit every joint after the base to +-DEG degrees (not with fabrik)\n"
+         << "  --reach MODE      Screen targets with a reachability map: reject or clamp\n"
+         << "  --record FILE     Record the targets and every iteration to FILE (not with --stream or --serve)\n"
+         << "  --replay FILE     Replay a recording, check its angles and compare its timing\n"
+         << "  --stream SOURCE   Solve targets read from SOURCE: - for stdin, unix:PATH or a file\n"
+         << "  --output FILE     Stream: write solutions to FILE (default stdout)\n"
+         << "  --format NAME     Stream: csv or binary (default csv)\n"
+         << "  --batch N         Stream: solve and write up to N targets at a time (default 64)\n"
+         << "  --predict         Stream: start each solve from the predicted motion of the target\n"
+         << "  --serve PATH      Answer solve requests on the Unix socket PATH until interrupted\n"
+         << "  --arms N          Draw N copies of the arm with OpenGL 3.3 instancing\n"
+         << "  --headless        Run without a window and print statistics\n"
+         << "  --targets N       Headless: stop after N targets reached or abandoned (default 1000, 0 for no limit)\n"
+         << "  --steps N         Headless: stop after N solver iterations (default no limit)\n"
+         << "  --json            Headless, replay and stream: print statistics as JSON\n";
+}
+
 int main(int argc, char *argv[])
 {
-    cout << "COMP 376 Assignment 2 Problem 2 \n" << "ESC Quit";
+    HeadlessOptions options;
+    bool headless = false;
+    bool targetsGiven = false;
+    bool solverGiven = false;
+    bool unknown = false;
+    string solverName = "jacobian";
+    string tableFile;
+    string reachMode;
+    string recordFile, replayFile;
+    string streamSource, streamOutput, streamFormat = "csv";
+    string servePath;
+    StreamOptions streamOptions;
+    double limit = 0;
+    int method = PSEUDO_INVERSE;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--json")
+            options.json = true;
+        else if (arg == "--solver" && hasValue)
+        {
+            solverName = argv[++i];
+            solverGiven = true;
+        }
+        else if (arg == "--method" && hasValue)
+        {
+            string name = argv[++i];
+            for (method = 0; methodNames[method] && name != methodNames[method]; ++method)
+                ;
+        }
+        else if (arg == "--seed" && hasValue)
+            options.seed = strtoul(argv[++i], 0, 10);
+        else if (arg == "--table" && hasValue)
+            tableFile = argv[++i];
+        else if (arg == "--record" && hasValue)
+            recordFile = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            replayFile = argv[++i];
+        else if (arg == "--serve" && hasValue)
+            servePath = argv[++i];
+        else if (arg == "--stream" && hasValue)
+            streamSource = argv[++i];
+        else if (arg == "--output" && hasValue)
+            streamOutput = argv[++i];
+        else if (arg == "--format" && hasValue)
+            streamFormat = argv[++i];
+        else if (arg == "--batch" && hasValue)
+            streamOptions.batch = atoi(argv[++i]);
+        else if (arg == "--predict")
+            streamOptions.predict = true;
+        else if (arg == "--arms" && hasValue)
+            arms = atoi(argv[++i]);
+        else if (arg == "--limits" && hasValue)
+            limit = atof(argv[++i]);
+        else if (arg == "--reach" && hasValue)
+            reachMode = argv[++i];
+        else if (arg == "--targets" && hasValue)
+        {
+            options.targets = atol(argv[++i]);
+            targetsGiven = true;
+        }
+        else if (arg == "--steps" && hasValue)
+            options.steps = atol(argv[++i]);
+        else if (arg == "--help")
+        {
+            usage();
+            return 0;
+        }
+        else
+            unknown = true;     // Possibly a GLUT option for glutInit()
+    }
+    if (options.steps > 0 && !targetsGiven)
+        options.targets = 0;
+
+    // Streamed and served targets are solved to convergence, which the
+    // fixed 0.01 unit steps of plain jacobian take thousands of iterations for
+    if (!solverGiven && (!streamSource.empty() || !servePath.empty()))
+        solverName = "jacobian-ls";
+
+    IKSolver *check = newSolver(solverName);
+    bool valid = check != 0;
+    delete check;
+    if (!reachMode.empty() && reachMode != "reject" && reachMode != "clamp")
+        valid = false;
+    if ((streamFormat != "csv" && streamFormat != "binary") || streamOptions.batch < 1 || arms < 0 ||
+        options.targets < 0 || options.steps < 0)
+        valid = false;
+    if (!recordFile.empty() && (!servePath.empty() || !streamSource.empty()))
+        valid = false;      // Only the window and headless runs are recorded
+    if (limit > 0 && solverName == "fabrik")
+        valid = false;      // FABRIK ignores joint limits
+    if (!valid || !methodNames[method] || (headless && (unknown || (options.targets == 0 && options.steps == 0))))
+    {
+        usage();
+        return 1;
+    }
+
+    if (!replayFile.empty())
+    {
+        SessionReader log(replayFile);
+        if (!log.good())
+        {
+            cerr << replayFile << ": not a recording\n";
+            return 1;
+        }
+        ReplayReport report = runReplay(log);
+        printReplay(cout, report, options.json);
+        return report.complete && report.mismatches == 0 ? 0 : 1;
+    }
+
+    rng = IKRandom(options.seed);
+    initializeArm(solverName, IKMethod(method));
+    if (!tableFile.empty())
+    {
+        if (!table.load(tableFile) || !table.matches(*arm))
+        {
+            cerr << tableFile << ": not a workspace table for this arm\n";
+            return 1;
+        }
+        options.table = &table;
+    }
+    for (int i = 1; i < numLinks && limit > 0; ++i)
+        arm->setLimits(i, -limit * PI / 180, limit * PI / 180);
+    if (!reachMode.empty())
+    {
+        TaskPool pool;
+        reachMap.build(*arm, 128, 1 << 21, pool);
+        clampTargets = reachMode == "clamp";
+        options.reach = &reachMap;
+        options.clampTargets = clampTargets;
+    }
+    if (!recordFile.empty())
+    {
+        recorder = new SessionRecorder(recordFile, *arm, options.seed);
+        if (!recorder->good())
+        {
+            cerr << recordFile << ": cannot write the recording\n";
+            return 1;
+        }
+        options.recorder = recorder;
+    }
+    if (!servePath.empty())
+    {
+        service = new IKService(*arm, solverName);
+        if (!service->listen(servePath))
+        {
+            cerr << servePath << ": cannot listen on the socket\n";
+            return 1;
+        }
+        signal(SIGINT, stopService);
+        signal(SIGTERM, stopService);
+        service->run();
+        cerr << "answered " << service->requests() << " requests in " << service->batches()
+             << " batches, largest " << service->largestBatch() << endl;
+        delete service;
+        return 0;
+    }
+    if (!streamSource.empty())
+    {
+        FILE *in = 0, *out = 0;
+        if (streamSource == "-")
+            in = stdin;
+        else if (streamSource.compare(0, 5, "unix:") == 0)
+            acceptUnixSocket(streamSource.substr(5), in, out);
+        else
+            in = fopen(streamSource.c_str(), "r");
+        if (!streamOutput.empty())
+        {
+            if (out)
+                fclose(out);
+            out = fopen(streamOutput.c_str(), streamFormat == "binary" ? "wb" : "w");
+        }
+        else if (!out)
+            out = stdout;
+        if (!in || !out)
+        {
+            cerr << streamSource << ": cannot open the stream\n";
+            return 1;
+        }
+        streamOptions.binary = streamFormat == "binary";
+        streamOptions.table = options.table;
+        printStreamReport(cerr, runStream(*arm, *solver, in, out, streamOptions), options.json);
+        return 0;
+    }
+    if (headless)
+    {
+        printReport(cout, runHeadless(*arm, *solver, rng, options), options.json);
+        delete recorder;
+        return 0;
+    }
+    if (recorder)
+        recorder->solver(solver->name(), *arm);
+
+    cout << "COMP 376 Assignment 2 Problem 2 \n" << "ESC Quit\n" << "m   Cycle IK method\n" << "s   Cycle IK solver\n" << "u   Show links updated and triangles drawn per frame";
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    if (arms > 0)
+    {
+        // The instanced renderer has no fixed-function state to set up
+        glutInitContextVersion(3, 3);
+        glutInitContextProfile(GLUT_CORE_PROFILE);
+    }
     glutInitWindowSize(windowWidth, windowHeight);
     glutInitWindowPosition(0, 0);
     glutCreateWindow("COMP 376 Assignment 2 Problem 2");
@@ -300,11 +620,15 @@ int main(int argc, char *argv[])
     glutReshapeFunc(reshape);
     glutIdleFunc(idle);
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
-    glLightfv(GL_LIGHT0, GL_POSITION, dir);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, white);
-    glMaterialfv(GL_FRONT, GL_SHININESS, shiny);
+    if (arms == 0)
+    {
+        glEnable(GL_LIGHTING);
+        glEnable(GL_LIGHT0);
+        glEnable(GL_NORMALIZE);
+        glLightfv(GL_LIGHT0, GL_POSITION, dir);
+        glMaterialfv(GL_FRONT, GL_SPECULAR, white);
+        glMaterialfv(GL_FRONT, GL_SHININESS, shiny);
+    }
     initialize();
     glutMainLoop();
     return 0;